@@ -0,0 +1,190 @@
+#include<cstdint>
+#include<vector>
+#include<random>
+#include<cmath>
+#include<unordered_map>
+
+#include "addressDenoiser.h"
+#include "linearSolver.h"
+
+using namespace std;
+
+// Number of random addresses per group the linear system is solved for
+#define DENOISE_ADDRESSES_PER_GROUP 4
+// Upper limit for the number of iterations
+#define DENOISE_MAX_ITERATIONS 1000
+// Probability that at least one iteration only sampled correctly grouped
+// addresses when the iterations stop
+#define DENOISE_CONFIDENCE 0.99
+
+AddressDenoiser::AddressDenoiser(vector<vector<uint64_t>*> *physicalAddresses, uint64_t columns, uint64_t nBanks) {
+  this->physicalAddresses = physicalAddresses;
+  this->columns = columns;
+  this->nFunctions = 0;
+  while((1UL<<nFunctions) < nBanks) {
+    nFunctions++;
+  }
+  this->nIterations = 0;
+  this->generator.seed(0x616d647265);
+  this->nRelabeledAddresses = new vector<uint64_t>(physicalAddresses->size(), 0);
+  this->nEvictedAddresses = new vector<uint64_t>(physicalAddresses->size(), 0);
+}
+
+AddressDenoiser::~AddressDenoiser() {
+  delete nRelabeledAddresses;
+  delete nEvictedAddresses;
+}
+
+vector<uint64_t> *AddressDenoiser::sampleFunctions() {
+  // The first sampled address of each group is its anchor, so it is drawn like
+  // every other address (the first address of a group can be wrong as well).
+  LinearSolver linearSolver(columns);
+  for(uint64_t groupIdx = 0; groupIdx < physicalAddresses->size(); groupIdx++) {
+    vector<uint64_t> *group = (*physicalAddresses)[groupIdx];
+    for(uint64_t i = 0; i < DENOISE_ADDRESSES_PER_GROUP && !group->empty(); i++) {
+      linearSolver.addAddress(groupIdx, (*group)[generator() % group->size()]);
+    }
+  }
+
+  // Too few functions means a wrongly grouped address was sampled, too many
+  // means the sample was too small to determine the functions.
+  vector<uint64_t> *functions = linearSolver.getFunctions();
+  if(functions->size() != nFunctions) {
+    delete functions;
+    return NULL;
+  }
+  return functions;
+}
+
+uint64_t AddressDenoiser::getCode(uint64_t physicalAddress, vector<uint64_t> *functions) {
+  uint64_t code = 0;
+  for(uint64_t i = 0; i < functions->size(); i++) {
+    code |= (uint64_t)__builtin_parityl(physicalAddress & (*functions)[i]) << i;
+  }
+  return code;
+}
+
+uint64_t AddressDenoiser::countInliers(vector<uint64_t> *functions, vector<uint64_t> *groupCodes) {
+  // Every group gets its majority code. The solution is only valid when no two
+  // groups share a code.
+  groupCodes->clear();
+  unordered_map<uint64_t, uint64_t> codeGroups;
+  uint64_t nInliers = 0;
+  for(uint64_t groupIdx = 0; groupIdx < physicalAddresses->size(); groupIdx++) {
+    unordered_map<uint64_t, uint64_t> codeCounts;
+    uint64_t groupCode = 0;
+    uint64_t nGroupInliers = 0;
+    for(uint64_t physicalAddress : *(*physicalAddresses)[groupIdx]) {
+      uint64_t code = getCode(physicalAddress, functions);
+      uint64_t count = ++codeCounts[code];
+      if(count > nGroupInliers) {
+        nGroupInliers = count;
+        groupCode = code;
+      }
+    }
+    groupCodes->push_back(groupCode);
+    if(nGroupInliers == 0) {
+      continue;
+    }
+    if(codeGroups.count(groupCode)) {
+      return 0;
+    }
+    codeGroups[groupCode] = groupIdx;
+    nInliers += nGroupInliers;
+  }
+  return nInliers;
+}
+
+bool AddressDenoiser::denoise() {
+  uint64_t nAddresses = 0;
+  uint64_t nSampledAddresses = 0;
+  for(vector<uint64_t> *group : *physicalAddresses) {
+    nAddresses += group->size();
+    nSampledAddresses += group->empty() ? 0 : DENOISE_ADDRESSES_PER_GROUP;
+  }
+
+  vector<uint64_t> *bestFunctions = NULL;
+  vector<uint64_t> bestGroupCodes;
+  vector<uint64_t> groupCodes;
+  uint64_t bestInliers = 0;
+  uint64_t nRequiredIterations = DENOISE_MAX_ITERATIONS;
+  for(nIterations = 0; nIterations < nRequiredIterations; nIterations++) {
+    vector<uint64_t> *functions = sampleFunctions();
+    if(functions == NULL) {
+      continue;
+    }
+    uint64_t nInliers = countInliers(functions, &groupCodes);
+    if(nInliers <= bestInliers) {
+      delete functions;
+      continue;
+    }
+    delete bestFunctions;
+    bestFunctions = functions;
+    bestGroupCodes = groupCodes;
+    bestInliers = nInliers;
+
+    // The share of inliers of the best solution so far is an estimate for the
+    // probability that an address is correctly grouped. Enough iterations are
+    // done so that at least one of them only sampled correctly grouped
+    // addresses.
+    double pCleanSample = pow((double)bestInliers / nAddresses, nSampledAddresses);
+    if(pCleanSample >= 1) {
+      nRequiredIterations = nIterations + 1;
+    } else if(pCleanSample > 0) {
+      double iterations = ceil(log(1 - DENOISE_CONFIDENCE) / log(1 - pCleanSample));
+      if(iterations < DENOISE_MAX_ITERATIONS) {
+        nRequiredIterations = (uint64_t)iterations;
+      }
+    }
+  }
+
+  if(bestFunctions == NULL) {
+    return false;
+  }
+
+  unordered_map<uint64_t, uint64_t> codeGroups;
+  for(uint64_t groupIdx = 0; groupIdx < physicalAddresses->size(); groupIdx++) {
+    if(!(*physicalAddresses)[groupIdx]->empty()) {
+      codeGroups[bestGroupCodes[groupIdx]] = groupIdx;
+    }
+  }
+
+  // Relabeled addresses are appended to their new group, so the first address
+  // of every group is still one that was grouped there.
+  vector<vector<uint64_t>> relabeledAddresses(physicalAddresses->size());
+  for(uint64_t groupIdx = 0; groupIdx < physicalAddresses->size(); groupIdx++) {
+    vector<uint64_t> *group = (*physicalAddresses)[groupIdx];
+    uint64_t nKept = 0;
+    for(uint64_t physicalAddress : *group) {
+      uint64_t code = getCode(physicalAddress, bestFunctions);
+      if(code == bestGroupCodes[groupIdx]) {
+        (*group)[nKept++] = physicalAddress;
+      } else if(codeGroups.count(code)) {
+        relabeledAddresses[codeGroups[code]].push_back(physicalAddress);
+        (*nRelabeledAddresses)[groupIdx]++;
+      } else {
+        (*nEvictedAddresses)[groupIdx]++;
+      }
+    }
+    group->resize(nKept);
+  }
+  for(uint64_t groupIdx = 0; groupIdx < physicalAddresses->size(); groupIdx++) {
+    vector<uint64_t> *group = (*physicalAddresses)[groupIdx];
+    group->insert(group->end(), relabeledAddresses[groupIdx].begin(), relabeledAddresses[groupIdx].end());
+  }
+
+  delete bestFunctions;
+  return true;
+}
+
+uint64_t AddressDenoiser::getNumberOfIterations() {
+  return nIterations;
+}
+
+uint64_t AddressDenoiser::getNumberOfRelabeledAddresses(uint64_t groupIdx) {
+  return (*nRelabeledAddresses)[groupIdx];
+}
+
+uint64_t AddressDenoiser::getNumberOfEvictedAddresses(uint64_t groupIdx) {
+  return (*nEvictedAddresses)[groupIdx];
+}
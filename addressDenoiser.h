@@ -0,0 +1,41 @@
+#ifndef ADDRESS_DENOISER_H
+#define ADDRESS_DENOISER_H
+
+#include<cstdint>
+#include<vector>
+#include<random>
+
+using namespace std;
+
+/**
+ * AddressDenoiser removes wrongly grouped addresses before the address
+ * functions are derived (RANSAC). In every iteration, the linear system is
+ * solved for a few random addresses of each group. The solution assigns a code
+ * to every address; an address is an inlier when its code matches the majority
+ * code of its group. The solution with the most inliers is kept.
+ *
+ * Outliers whose code matches the majority code of another group are moved to
+ * that group, all other outliers are removed.
+ */
+class AddressDenoiser {
+  private:
+    vector<vector<uint64_t>*> *physicalAddresses;
+    uint64_t columns;
+    uint64_t nFunctions;
+    uint64_t nIterations;
+    mt19937_64 generator;
+    vector<uint64_t> *nRelabeledAddresses;
+    vector<uint64_t> *nEvictedAddresses;
+    vector<uint64_t> *sampleFunctions();
+    uint64_t getCode(uint64_t physicalAddress, vector<uint64_t> *functions);
+    uint64_t countInliers(vector<uint64_t> *functions, vector<uint64_t> *groupCodes);
+  public:
+    AddressDenoiser(vector<vector<uint64_t>*> *physicalAddresses, uint64_t columns, uint64_t nBanks);
+    ~AddressDenoiser();
+    bool denoise();
+    uint64_t getNumberOfIterations();
+    uint64_t getNumberOfRelabeledAddresses(uint64_t groupIdx);
+    uint64_t getNumberOfEvictedAddresses(uint64_t groupIdx);
+};
+
+#endif
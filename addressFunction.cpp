@@ -2,23 +2,34 @@
 #include<mutex>
 #include<cstdio>
 #include<algorithm>
+#include<unordered_map>
 
 #include "addressFunction.h"
 #include "maskThread.h"
+#include "linearSolver.h"
+#include "gf2Basis.h"
+#include "maskVerifier.h"
+#include "addressDenoiser.h"
+#include "dataset.h"
 #include "helper.h"
 
-AddressFunction::AddressFunction(BankGroup *bankGroup, Config *config) {
-  this->bankGroup = bankGroup;
+// Confidence level of the intervals reported for the agreement rates
+#define VERIFICATION_CONFIDENCE 0.95
+
+AddressFunction::AddressFunction(BankGroup *bankGroup, Config *config) : AddressFunction(bankGroup->getPhysicalAddresses(), bankGroup->getBlockSize(), bankGroup->getNumberOfBanks(), config) {
+}
+
+AddressFunction::AddressFunction(vector<vector<uint64_t>*> *physicalAddresses, uint64_t blockSize, uint64_t nBanks, Config *config) {
   this->config = config;
-  this->blockSize = bankGroup->getBlockSize();
+  this->physicalAddresses = physicalAddresses;
+  this->blockSize = blockSize;
+  this->nBanks = nBanks;
   addressBitMasksForBanks = new vector<uint64_t>();
 
   skipLastNBits = 0;
   while(blockSize >> skipLastNBits > 1) {
     skipLastNBits ++;
   }
-
-  physicalAddresses = bankGroup->getPhysicalAddresses();
 }
 
 AddressFunction::~AddressFunction(void) {
@@ -27,6 +38,53 @@ AddressFunction::~AddressFunction(void) {
     delete physicalAddress;
   }
   delete physicalAddresses;
+  if(heldOutAddresses != NULL) {
+    for(vector<uint64_t> *heldOutAddress : *heldOutAddresses) {
+      delete heldOutAddress;
+    }
+    delete heldOutAddresses;
+  }
+}
+
+bool AddressFunction::saveDataset(string path) {
+  return ::saveDataset(path, physicalAddresses, blockSize, nBanks);
+}
+
+void AddressFunction::prepareAddresses() {
+  // Held out and wrongly grouped addresses are only removed once, before the
+  // first masks are searched.
+  if(addressesPrepared) {
+    return;
+  }
+  addressesPrepared = true;
+
+  if(config->getHoldoutPercentage() > 0) {
+    holdOutAddresses(config->getHoldoutPercentage());
+  }
+  if(config->isDenoisingEnabled()) {
+    denoiseAddresses();
+  }
+}
+
+void AddressFunction::holdOutAddresses(uint64_t percentage) {
+  // The held out addresses are spread evenly over each group (and therefore
+  // over all THPs). The first address of a group is never held out.
+  heldOutAddresses = new vector<vector<uint64_t>*>();
+  for(uint64_t groupIdx = 0; groupIdx < physicalAddresses->size(); groupIdx++) {
+    vector<uint64_t> *group = (*physicalAddresses)[groupIdx];
+    vector<uint64_t> *remainingAddresses = new vector<uint64_t>();
+    vector<uint64_t> *heldOutGroup = new vector<uint64_t>();
+    for(uint64_t i = 0; i < group->size(); i++) {
+      if((i + 1) * percentage / 100 > i * percentage / 100) {
+        heldOutGroup->push_back((*group)[i]);
+      } else {
+        remainingAddresses->push_back((*group)[i]);
+      }
+    }
+    delete group;
+    (*physicalAddresses)[groupIdx] = remainingAddresses;
+    heldOutAddresses->push_back(heldOutGroup);
+  }
 }
 
 bool AddressFunction::areMasksOrthogonal(vector<uint64_t> *masks) {
@@ -92,31 +150,15 @@ void AddressFunction::setUnifiedAddressMasks(vector<uint64_t> *addressMasks) {
     return;
   }
 
-	sort(addressMasks->begin(), addressMasks->end(), less<int>());
-  addressBitMasksForBanks->push_back((*addressMasks)[0]);
+	sort(addressMasks->begin(), addressMasks->end(), less<uint64_t>());
 
+  // A mask is only added when it is not a combination (sum) of the masks
+  // added before, e.g. when it is independent of the basis built so far.
+  GF2Basis basis;
 	for(uint64_t currentMask: *addressMasks) {
-		vector<uint64_t> *sums = new vector<uint64_t>();
-
-		for(uint64_t validMask: *addressBitMasksForBanks) {
-			uint64_t nSums = sums->size();
-			for(uint64_t x = 0; x < nSums; x++) {
-        uint64_t combinedMask = (*sums)[x] ^ validMask;
-				sums->push_back(combinedMask);
-			}
-			sums->push_back(validMask);
-		}
-		bool matchesSum = false;
-		for(uint64_t sum : *sums) {
-			if(sum == currentMask) {
-				matchesSum = true;
-			}
-		}
-
-		if(!matchesSum) {
+		if(basis.addVector(currentMask)) {
 			addressBitMasksForBanks->push_back(currentMask);
 		}
-    delete sums;
 	}
 
   if(areMasksOrthogonal()) {
@@ -150,73 +192,285 @@ void AddressFunction::setUnifiedAddressMasks(vector<uint64_t> *addressMasks) {
 }
 
 uint64_t AddressFunction::getRelevantBits() {
-  uint64_t mask = 0x00;
-  uint64_t firstAddress = (*(*physicalAddresses)[0])[0];
-  uint64_t firstAddressBankIdx = 0;
-  uint64_t wantedAddress = 0x00;
-  vector<uint64_t> *group = NULL;
+  // Index all physical addresses by their group, so the address that differs
+  // in a single bit can be looked up directly instead of scanning all groups.
+  uint64_t nAddresses = 0;
+  for(vector<uint64_t> *group : *physicalAddresses) {
+    nAddresses += group->size();
+  }
+  if(nAddresses == 0) {
+    return 0;
+  }
 
+  unordered_map<uint64_t, uint64_t> groupIndex;
+  groupIndex.reserve(nAddresses);
+  uint64_t firstAddress = 0;
+  uint64_t varyingBits = 0;
+  bool firstAddressSet = false;
   for(uint64_t idx = 0; idx < physicalAddresses->size(); idx++) {
-    group = (*physicalAddresses)[idx];
-    for(uint64_t address : *group) {
-      if(address < firstAddress) {
+    for(uint64_t address : *(*physicalAddresses)[idx]) {
+      groupIndex[address] = idx;
+      if(!firstAddressSet) {
         firstAddress = address;
-        firstAddressBankIdx = idx;
+        firstAddressSet = true;
       }
+      varyingBits |= address ^ firstAddress;
     }
   }
 
-  // Start with a shift of block size since it is not possible to detect bits
-  // below that
-  for(uint64_t cnt = skipLastNBits; cnt < sizeof(uint64_t) * 8; cnt++) {
-    wantedAddress = firstAddress ^ (1UL<<cnt);
-    bool foundWantedAddress = false;
-
-    for(uint64_t idx = 0; idx < physicalAddresses->size(); idx++) {
-      group = (*physicalAddresses)[idx];
-      for(uint64_t address : *group) {
-        if(address == wantedAddress) {
-          // Found an address that differs only in one bit
-          foundWantedAddress = true;
-          if(idx != firstAddressBankIdx) {
-            printf("Bit %ld is relevant.\n", cnt);
-            // That address is in another bank, so the bit has in influence to
-            // the bank calculation (otherwise, the address would be at the
-            // same bank and the bit would not have an impact)
-            mask |= (1UL<<cnt);
-          }
-        }
+  // Flip each bit of several base addresses (distributed over all groups). When
+  // the resulting address is in another bank, the bit has an influence to the
+  // bank calculation. When it is in the same bank, no function uses the bit.
+  uint64_t relevantVotes[64] = {0};
+  uint64_t irrelevantVotes[64] = {0};
+  uint64_t nBases = config->getNumberOfRelevantBitBases();
+  for(uint64_t base = 0; base < nBases && base < nAddresses; base++) {
+    uint64_t baseIdx = base * nAddresses / min(nBases, nAddresses);
+    uint64_t groupIdx = 0;
+    while(baseIdx >= (*physicalAddresses)[groupIdx]->size()) {
+      baseIdx -= (*physicalAddresses)[groupIdx]->size();
+      groupIdx++;
+    }
+    uint64_t baseAddress = (*(*physicalAddresses)[groupIdx])[baseIdx];
+
+    for(uint64_t bit = skipLastNBits; bit < sizeof(uint64_t) * 8; bit++) {
+      unordered_map<uint64_t, uint64_t>::iterator wantedAddress = groupIndex.find(baseAddress ^ (1UL<<bit));
+      if(wantedAddress == groupIndex.end()) {
+        continue;
+      }
+      if(wantedAddress->second != groupIdx) {
+        relevantVotes[bit]++;
+      } else {
+        irrelevantVotes[bit]++;
       }
     }
+  }
 
-    if(!foundWantedAddress) {
-      // The address that differs only in one bit was not found in the given
-      // addresses. Therefore, it is added as candidate for calculation.
-      printf("No address found for bit %ld\n", cnt);
-      mask |= (1UL<<cnt);
+  uint64_t mask = 0x00;
+  for(uint64_t bit = skipLastNBits; bit < sizeof(uint64_t) * 8; bit++) {
+    if(!(varyingBits>>bit&1)) {
+      // The bit is the same for all addresses. A minimal mask can not contain
+      // it, since removing the bit would result in an equivalent mask.
+      continue;
     }
+    if(irrelevantVotes[bit] > relevantVotes[bit]) {
+      printLogMessage(LOG_DEBUG, "Bit " + to_string(bit) + " is not relevant (" + to_string(irrelevantVotes[bit]) + " of " + to_string(irrelevantVotes[bit] + relevantVotes[bit]) + " flips stayed in the same bank).");
+      continue;
+    }
+    // The bit is relevant or no address was found to decide it, so it is kept
+    // as candidate for the calculation.
+    mask |= (1UL<<bit);
   }
-  printf("[DEBUG]: Identified mask of relevant bits: 0x%lx\n", mask);
+
+  char number[20];
+  snprintf(number, 20, "0x%lx", mask);
+  printLogMessage(LOG_DEBUG, "Identified mask of relevant bits: " + string(number) + " (" + to_string(countBits(mask)) + " bits).");
   return mask;
 }
 
-bool AddressFunction::calculateBitMasks(uint64_t nThreads) {
-	vector<uint64_t> validMasks;
+vector<vector<uint64_t>*> *AddressFunction::getSampledPhysicalAddresses(uint64_t sampleSize) {
+  // A mask is only rejected by the sample when the sample has more errors than
+  // allowed for the whole group, so the sample of each group also contains
+  // twice the number of tolerated errors.
+  vector<uint64_t> groupSampleSizes;
+  bool groupBiggerThanSample = false;
+  for(vector<uint64_t> *group : *physicalAddresses) {
+    uint64_t maxErrors = group->size() * config->getMaximumErrorPercentageForValidMasks() / 100;
+    uint64_t groupSampleSize = min((uint64_t)group->size(), sampleSize + 2 * maxErrors);
+    groupBiggerThanSample = groupBiggerThanSample || group->size() > groupSampleSize;
+    groupSampleSizes.push_back(groupSampleSize);
+  }
+
+  // Sampling only makes sense when at least one group is bigger than its
+  // sample.
+  if(!groupBiggerThanSample) {
+    return NULL;
+  }
+
+  vector<vector<uint64_t>*> *samples = new vector<vector<uint64_t>*>();
+  for(uint64_t groupIdx = 0; groupIdx < physicalAddresses->size(); groupIdx++) {
+    vector<uint64_t> *group = (*physicalAddresses)[groupIdx];
+    vector<uint64_t> *sample = new vector<uint64_t>();
+    // The addresses are spread over the whole group, the first one is always
+    // part of the sample.
+    for(uint64_t i = 0; i < groupSampleSizes[groupIdx]; i++) {
+      sample->push_back((*group)[i * group->size() / groupSampleSizes[groupIdx]]);
+    }
+    samples->push_back(sample);
+  }
+  return samples;
+}
+
+void AddressFunction::searchMasks(vector<uint64_t> *validMasks, uint64_t nThreads, uint64_t shardIdx, uint64_t nShards) {
 	mutex validMasksMutex;
 
+  // The addresses are transposed once and shared by all threads
+  BitSlicedAddresses *bitSlicedAddresses = new BitSlicedAddresses(physicalAddresses);
+  printLogMessage(LOG_DEBUG, "Using the " + bitSlicedAddresses->getKernelName() + " kernel to evaluate mask candidates.");
+
+  // A small sample of each group (starting with the first address of the
+  // group) is stored separately, so most candidates can be rejected without
+  // touching all addresses.
+  BitSlicedAddresses *sampledAddresses = NULL;
+  vector<vector<uint64_t>*> *samples = getSampledPhysicalAddresses(config->getSampleSize());
+  if(samples != NULL) {
+    sampledAddresses = new BitSlicedAddresses(samples);
+    for(vector<uint64_t> *sample : *samples) {
+      delete sample;
+    }
+    delete samples;
+  }
+
+  // Candidates can use all bits above the block size or, when pruning is
+  // enabled, only the bits that are relevant for the bank.
+  uint64_t alphabet = ~((1UL<<skipLastNBits) - 1);
+  if(config->isMaskBitPruningEnabled()) {
+    alphabet = getRelevantBits();
+  }
+  MaskScheduler *maskScheduler = new MaskScheduler(alphabet, config->getMaximumNumberOfMaskBits(), nThreads, shardIdx, nShards);
+  if(nShards > 1) {
+    printLogMessage(LOG_DEBUG, "Searching " + to_string(maskScheduler->getNumberOfCandidates()) + " mask candidates of shard " + to_string(shardIdx) + "/" + to_string(nShards) + " with " + to_string(nThreads) + " threads.");
+  } else {
+    printLogMessage(LOG_DEBUG, "Searching " + to_string(maskScheduler->getNumberOfCandidates()) + " mask candidates with " + to_string(nThreads) + " threads.");
+  }
+
+  // Valid masks are collected in a shared basis to stop the search after the
+  // number of bits at which they separate all banks.
+  MaskBasis *maskBasis = NULL;
+  if(config->isEarlySearchTerminationEnabled()) {
+    maskBasis = new MaskBasis(bitSlicedAddresses, nBanks);
+  }
+
 	vector<MaskThread*> maskThreads;
 	for(uint64_t i = 0; i < nThreads; i++) {
-		MaskThread *maskThread = new MaskThread(config, i, skipLastNBits, physicalAddresses, &validMasks, &validMasksMutex);
+		MaskThread *maskThread = new MaskThread(config, i, skipLastNBits, physicalAddresses, bitSlicedAddresses, sampledAddresses, maskScheduler, maskBasis, validMasks, &validMasksMutex);
 		maskThreads.push_back(maskThread);
 	}
 
 	// Wait for all threads to finish
+  uint64_t nSampleChecks = 0;
+  uint64_t nSampleRejects = 0;
 	for(MaskThread *maskThread: maskThreads) {
 		maskThread->getThreadReference()->join();
+    nSampleChecks += maskThread->getNumberOfSampleChecks();
+    nSampleRejects += maskThread->getNumberOfSampleRejects();
 		delete maskThread;
 	}
+  if(sampledAddresses != NULL) {
+    printLogMessage(LOG_DEBUG, "The sample check rejected " + to_string(nSampleRejects) + " of " + to_string(nSampleChecks) + " candidates, " + to_string(nSampleChecks - nSampleRejects) + " were checked with all addresses.");
+  }
+  printLogMessage(LOG_DEBUG, "Threads stole work " + to_string(maskScheduler->getNumberOfSteals()) + " times.");
+  if(maskBasis != NULL && maskBasis->isComplete()) {
+    printLogMessage(LOG_DEBUG, "The valid masks separate all banks, stopped the search after at most " + to_string(maskScheduler->getNumberOfScheduledCandidates()) + " of " + to_string(maskScheduler->getNumberOfCandidates()) + " candidates.");
+  }
+  delete maskBasis;
+  delete maskScheduler;
+  delete sampledAddresses;
+  delete bitSlicedAddresses;
+}
+
+void AddressFunction::solveLinearSystem(vector<uint64_t> *validMasks) {
+  // Bits below the block size can not be measured, so they are not part of
+  // the linear system.
+  uint64_t columns = ~((1UL<<skipLastNBits) - 1);
+  LinearSolver *linearSolver = new LinearSolver(columns);
+  linearSolver->addGroups(physicalAddresses);
+
+  uint64_t nFunctions = linearSolver->getNumberOfFunctions();
+  printLogMessage(LOG_DEBUG, "The linear system has " + to_string(nFunctions) + " independent solutions.");
+  if((1UL<<nFunctions) < nBanks) {
+    printLogMessage(LOG_WARNING, "The linear system has fewer solutions than expected for " + to_string(nBanks) + " banks. Some addresses might be in the wrong group.");
+  }
+
+  vector<uint64_t> *maskCandidates = linearSolver->getMaskCandidates();
+  validMasks->insert(validMasks->end(), maskCandidates->begin(), maskCandidates->end());
+  delete maskCandidates;
+  delete linearSolver;
+}
 
-	setUnifiedAddressMasks(&validMasks);
+static string formatAgreement(double rate, ConfidenceInterval interval) {
+  char text[100];
+  snprintf(text, 100, "%.2f%% (%.0f%% confidence interval: %.2f%% - %.2f%%)", rate * 100, VERIFICATION_CONFIDENCE * 100, interval.lower * 100, interval.upper * 100);
+  return string(text);
+}
+
+void AddressFunction::verifyMasks(uint64_t nThreads) {
+  // Without held out addresses, the functions are verified on the addresses
+  // they were derived from, which overestimates the agreement.
+  vector<vector<uint64_t>*> *verificationAddresses = heldOutAddresses != NULL ? heldOutAddresses : physicalAddresses;
+  MaskVerifier *maskVerifier = new MaskVerifier(verificationAddresses, addressBitMasksForBanks);
+  maskVerifier->estimateConfidenceIntervals(config->getNumberOfBootstrapSamples(), VERIFICATION_CONFIDENCE, nThreads);
+
+  string addressType = heldOutAddresses != NULL ? "held out" : "grouped";
+  printLogMessage(LOG_INFO, "Verified address functions on " + to_string(maskVerifier->getNumberOfAddresses()) + " " + addressType + " addresses.");
+  char number[20];
+  for(uint64_t i = 0; i < addressBitMasksForBanks->size(); i++) {
+    snprintf(number, 20, "0x%lx", (*addressBitMasksForBanks)[i]);
+    printLogMessage(LOG_INFO, "Address Function: " + string(number) + " agrees with the majority of the group for " + formatAgreement(maskVerifier->getAgreementRate(i), maskVerifier->getConfidenceInterval(i)) + " of the addresses.");
+  }
+  printLogMessage(LOG_INFO, "All address functions agree for " + formatAgreement(maskVerifier->getAgreementRate(), maskVerifier->getConfidenceInterval()) + " of the addresses.");
+
+  uint64_t nGroups = 0;
+  for(vector<uint64_t> *group : *verificationAddresses) {
+    if(group->size() != 0) {
+      nGroups++;
+    }
+  }
+  if(maskVerifier->getNumberOfDistinctGroupCodes() != nGroups) {
+    printLogMessage(LOG_WARNING, "The address functions only separate " + to_string(maskVerifier->getNumberOfDistinctGroupCodes()) + " of " + to_string(nGroups) + " groups of the " + addressType + " addresses.");
+  }
+  delete maskVerifier;
+}
+
+void AddressFunction::denoiseAddresses() {
+  uint64_t columns = ~((1UL<<skipLastNBits) - 1);
+  AddressDenoiser *addressDenoiser = new AddressDenoiser(physicalAddresses, columns, nBanks);
+  if(!addressDenoiser->denoise()) {
+    printLogMessage(LOG_WARNING, "Denoising failed after " + to_string(addressDenoiser->getNumberOfIterations()) + " iterations, all addresses are kept.");
+    delete addressDenoiser;
+    return;
+  }
+
+  uint64_t nRelabeled = 0;
+  uint64_t nEvicted = 0;
+  for(uint64_t groupIdx = 0; groupIdx < physicalAddresses->size(); groupIdx++) {
+    uint64_t nGroupRelabeled = addressDenoiser->getNumberOfRelabeledAddresses(groupIdx);
+    uint64_t nGroupEvicted = addressDenoiser->getNumberOfEvictedAddresses(groupIdx);
+    if(nGroupRelabeled != 0 || nGroupEvicted != 0) {
+      printLogMessage(LOG_DEBUG, "Group " + to_string(groupIdx) + ": moved " + to_string(nGroupRelabeled) + " addresses to other groups and removed " + to_string(nGroupEvicted) + " addresses.");
+    }
+    nRelabeled += nGroupRelabeled;
+    nEvicted += nGroupEvicted;
+  }
+  printLogMessage(LOG_INFO, "Denoising moved " + to_string(nRelabeled) + " and removed " + to_string(nEvicted) + " wrongly grouped addresses (" + to_string(addressDenoiser->getNumberOfIterations()) + " iterations).");
+  delete addressDenoiser;
+}
+
+vector<uint64_t> *AddressFunction::searchShard(uint64_t shardIdx, uint64_t nShards, uint64_t nThreads) {
+  vector<uint64_t> *validMasks = new vector<uint64_t>();
+  prepareAddresses();
+
+  // The linear system is solved at once, so the first shard does all the work.
+  if(config->getMaskSolver() == MASK_SOLVER_LINEAR) {
+    if(shardIdx == 0) {
+      solveLinearSystem(validMasks);
+    }
+  } else {
+    searchMasks(validMasks, nThreads, shardIdx, nShards);
+  }
+  return validMasks;
+}
+
+bool AddressFunction::calculateBitMasks(uint64_t nThreads) {
+  vector<uint64_t> *validMasks = searchShard(0, 1, nThreads);
+  bool success = calculateBitMasks(validMasks, nThreads);
+  delete validMasks;
+  return success;
+}
+
+bool AddressFunction::calculateBitMasks(vector<uint64_t> *validMasks, uint64_t nThreads) {
+  prepareAddresses();
+	setUnifiedAddressMasks(validMasks);
 
   printLogMessage(LOG_INFO, "Found " + to_string(addressBitMasksForBanks->size()) + " address functions.");
 	for(uint64_t mask : *addressBitMasksForBanks) {
@@ -225,8 +479,12 @@ bool AddressFunction::calculateBitMasks(uint64_t nThreads) {
     printLogMessage(LOG_INFO, "Address Function: " + string(number) + " seems to be valid.");
   }
 
-	if((uint64_t)(1<<addressBitMasksForBanks->size()) != bankGroup->getNumberOfBanks()) {
-    printLogMessage(LOG_WARNING, "The number of address functions (" + to_string(addressBitMasksForBanks->size()) + ") does not match the number of banks (" + to_string(bankGroup->getNumberOfBanks()) + ").");
+  if(addressBitMasksForBanks->size() != 0) {
+    verifyMasks(nThreads);
+  }
+
+	if((uint64_t)(1<<addressBitMasksForBanks->size()) != nBanks) {
+    printLogMessage(LOG_WARNING, "The number of address functions (" + to_string(addressBitMasksForBanks->size()) + ") does not match the number of banks (" + to_string(nBanks) + ").");
     return false;
 	}
 
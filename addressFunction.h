@@ -2,27 +2,42 @@
 #define ADDRESS_FUNCTION_H
 
 #include<cstdint>
+#include<string>
 #include<vector>
 
 #include "bankGroup.h"
+#include "bitSlicedAddresses.h"
 
 using namespace std;
 
 class AddressFunction {
   private:
-    BankGroup *bankGroup;
     Config *config;
     vector<vector<uint64_t>*> *physicalAddresses;
+    vector<vector<uint64_t>*> *heldOutAddresses = NULL;
+    bool addressesPrepared = false;
     uint64_t blockSize;
+    uint64_t nBanks;
     vector<uint64_t> *addressBitMasksForBanks = NULL;
     uint64_t skipLastNBits;
 		vector<uint64_t> *addressMasks;
 		void setUnifiedAddressMasks(vector<uint64_t> *addressMasks);
     uint64_t getRelevantBits();
+    vector<vector<uint64_t>*> *getSampledPhysicalAddresses(uint64_t sampleSize);
+    void searchMasks(vector<uint64_t> *validMasks, uint64_t nThreads, uint64_t shardIdx = 0, uint64_t nShards = 1);
+    void solveLinearSystem(vector<uint64_t> *validMasks);
+    void prepareAddresses();
+    void holdOutAddresses(uint64_t percentage);
+    void denoiseAddresses();
+    void verifyMasks(uint64_t nThreads);
   public:
     AddressFunction(BankGroup *bankGroup, Config *config);
+    AddressFunction(vector<vector<uint64_t>*> *physicalAddresses, uint64_t blockSize, uint64_t nBanks, Config *config);
     ~AddressFunction();
+    bool saveDataset(string path);
+    vector<uint64_t> *searchShard(uint64_t shardIdx, uint64_t nShards, uint64_t nThreads);
     bool calculateBitMasks(uint64_t nThreads = sysconf(_SC_NPROCESSORS_CONF));
+    bool calculateBitMasks(vector<uint64_t> *validMasks, uint64_t nThreads);
     vector<uint64_t> *getAddressBitMasksForBanks();
     bool areMasksOrthogonal(vector<uint64_t> *masks = NULL);
 };
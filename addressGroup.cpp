@@ -4,6 +4,7 @@
 #include<iostream>
 #include<vector>
 #include<algorithm>
+#include<cmath>
 
 
 #include "addressGroup.h"
@@ -11,16 +12,45 @@
 
 using namespace std;
 
-AddressGroup::AddressGroup(Config *config) {
+// Number of steps the measurements against one address are split into for
+// the sequential test
+#define SEQUENTIAL_STEPS_PER_ADDRESS 8
+// Assumed probability that a single step is on the wrong side of the
+// threshold
+#define SEQUENTIAL_STEP_ERROR_RATE 0.1
+// Number of representatives that fit into the buffers on the stack, more
+// representatives (-c) are stored on the heap
+#define REPRESENTATIVE_BUFFER_SIZE 64
+// Number of candidates per cached representative; the candidates that conflict
+// with most other candidates become the representatives
+#define CANDIDATES_PER_REPRESENTATIVE 2
+
+AddressGroup::AddressGroup(Config *config, ThresholdMonitor *thresholdMonitor) {
   this->addresses = new vector<void *>();
   this->blockSize = config->getBlockSize();
   this->nCompareAddresses = config->getNumberOfGroupAddressesToCompare();
   this->nMeasurementsPerComparison = config->getNumberOfMeasurementsPerGroupAddressComparisons();
   this->fenced = config->areMemoryFencesEnabled();
+  this->rowConflictThreshold = config->getRowConflictThreshold();
+  this->sequentialTimingConfidence = config->getSequentialTimingConfidence();
+  this->thresholdMonitor = thresholdMonitor;
+  this->cacheRepresentatives = config->isRepresentativeCachingEnabled();
+  this->cachedRepresentatives = new vector<void *>();
+  this->nAddressesAtCaching = 0;
+  this->cachedRepresentativesMutex = new mutex();
+}
+
+uint64_t AddressGroup::getRowConflictThreshold() {
+  if(thresholdMonitor != NULL) {
+    return thresholdMonitor->getThreshold();
+  }
+  return rowConflictThreshold;
 }
 
 AddressGroup::~AddressGroup(void) {
   delete addresses;
+  delete cachedRepresentatives;
+  delete cachedRepresentativesMutex;
 }
 
 void AddressGroup::addAddressToGroup(void *address) {
@@ -37,26 +67,192 @@ uint64_t AddressGroup::getBlockSize() {
 
 void AddressGroup::setBlockSize(uint64_t newBlockSize) {
   blockSize = newBlockSize;
+  // The addresses are replaced when the block size changes
+  clearCachedRepresentatives();
+}
+
+uint64_t AddressGroup::compareAddressTiming(void *address, uint64_t *nMeasurements) {
+  if(sequentialTimingConfidence > 0) {
+    return compareAddressTimingSequential(address, nMeasurements);
+  }
+  if(nMeasurements != NULL) {
+    *nMeasurements = min(nCompareAddresses, (uint64_t)addresses->size()) * nMeasurementsPerComparison;
+  }
+
+  // This is called for every address and group, so nothing is allocated
+  // unless more representatives are compared than fit on the stack.
+  void *representativeBuffer[REPRESENTATIVE_BUFFER_SIZE];
+  uint64_t accessTimeBuffer[REPRESENTATIVE_BUFFER_SIZE];
+  vector<void *> largeRepresentativeBuffer;
+  vector<uint64_t> largeAccessTimeBuffer;
+  void **representatives = representativeBuffer;
+  uint64_t *accessTimes = accessTimeBuffer;
+  if(nCompareAddresses > REPRESENTATIVE_BUFFER_SIZE) {
+    largeRepresentativeBuffer.resize(nCompareAddresses);
+    largeAccessTimeBuffer.resize(nCompareAddresses);
+    representatives = largeRepresentativeBuffer.data();
+    accessTimes = largeAccessTimeBuffer.data();
+  }
+
+  uint64_t nRepresentatives = getRepresentatives(nCompareAddresses, representatives);
+  for(uint64_t i = 0; i < nRepresentatives; i++) {
+    accessTimes[i] = measureAccessTime(representatives[i], address, nMeasurementsPerComparison, fenced);
+    if(thresholdMonitor != NULL) {
+      thresholdMonitor->addTime(accessTimes[i]);
+    }
+  }
+  if(nRepresentatives == 0) {
+    return 0;
+  }
+
+  nth_element(accessTimes, accessTimes + nRepresentatives/2, accessTimes + nRepresentatives, greater<uint64_t>());
+
+  return accessTimes[nRepresentatives/2];
+}
+
+uint64_t AddressGroup::compareAddressTimingSequential(void *address, uint64_t *nMeasurements) {
+  // Sequential probability ratio test: the measurements are done in small
+  // steps (alternating between the compared addresses). Each step is either
+  // above (conflict) or below the threshold, which is assumed to be wrong with
+  // SEQUENTIAL_STEP_ERROR_RATE. The test stops when the log likelihood ratio of
+  // both hypotheses passes one of the bounds for the configured confidence, or
+  // when all measurements of the fixed procedure were used.
+  uint64_t threshold = getRowConflictThreshold();
+  double errorRate = 1 - sequentialTimingConfidence / 100.0;
+  double upperBound = log((1 - errorRate) / errorRate);
+  double lowerBound = -upperBound;
+  double stepRatio = log((1 - SEQUENTIAL_STEP_ERROR_RATE) / SEQUENTIAL_STEP_ERROR_RATE);
+
+  void *representativeBuffer[REPRESENTATIVE_BUFFER_SIZE];
+  vector<void *> largeRepresentativeBuffer;
+  void **representatives = representativeBuffer;
+  if(nCompareAddresses > REPRESENTATIVE_BUFFER_SIZE) {
+    largeRepresentativeBuffer.resize(nCompareAddresses);
+    representatives = largeRepresentativeBuffer.data();
+  }
+  uint64_t nRepresentatives = getRepresentatives(nCompareAddresses, representatives);
+  uint64_t nMeasurementsPerStep = max(nMeasurementsPerComparison / SEQUENTIAL_STEPS_PER_ADDRESS, (uint64_t)1);
+  uint64_t maxSteps = nRepresentatives * min(nMeasurementsPerComparison, (uint64_t)SEQUENTIAL_STEPS_PER_ADDRESS);
+  vector<uint64_t> accessTimes;
+  accessTimes.reserve(maxSteps);
+  double logLikelihoodRatio = 0;
+  for(uint64_t step = 0; step < maxSteps && logLikelihoodRatio < upperBound && logLikelihoodRatio > lowerBound; step++) {
+    uint64_t time = measureAccessTime(representatives[step % nRepresentatives], address, nMeasurementsPerStep, fenced);
+    logLikelihoodRatio += time >= threshold ? stepRatio : -stepRatio;
+    accessTimes.push_back(time);
+    // The steps are what is compared with the threshold here, so the monitor
+    // follows their times
+    if(thresholdMonitor != NULL) {
+      thresholdMonitor->addTime(time);
+    }
+  }
+  if(nMeasurements != NULL) {
+    *nMeasurements = accessTimes.size() * nMeasurementsPerStep;
+  }
+  if(accessTimes.empty()) {
+    return 0;
+  }
+
+  // The median is used like in the fixed procedure, but it has to be on the
+  // side of the threshold the test decided for.
+  nth_element(accessTimes.begin(), accessTimes.begin() + accessTimes.size()/2, accessTimes.end(), greater<uint64_t>());
+  uint64_t medianTime = accessTimes[accessTimes.size()/2];
+  if(logLikelihoodRatio >= upperBound && medianTime < threshold) {
+    return threshold;
+  }
+  if(logLikelihoodRatio <= lowerBound && medianTime >= threshold) {
+    return threshold - 1;
+  }
+  return medianTime;
 }
 
-uint64_t AddressGroup::compareAddressTiming(void *address) {
-  vector<uint64_t>accessTimes;
+uint64_t AddressGroup::getRandomAddresses(uint64_t nAddresses, void **randomAddresses) {
+  uint64_t indexBuffer[REPRESENTATIVE_BUFFER_SIZE];
+  vector<uint64_t> largeIndexBuffer;
+  uint64_t *indices = indexBuffer;
+  if(nAddresses > REPRESENTATIVE_BUFFER_SIZE) {
+    largeIndexBuffer.resize(nAddresses);
+    indices = largeIndexBuffer.data();
+  }
+  uint64_t nRandomAddresses = getRandomIndices(addresses->size(), nAddresses, indices);
+  for(uint64_t i = 0; i < nRandomAddresses; i++) {
+    randomAddresses[i] = (*addresses)[indices[i]];
+  }
+  return nRandomAddresses;
+}
 
-  vector<uint64_t> *indices = getRandomIndices(addresses->size(), nCompareAddresses);
-  for(uint64_t index : *indices) {
-    accessTimes.push_back(measureAccessTime((*(addresses))[index], address, nMeasurementsPerComparison, fenced));
+vector<void *> *AddressGroup::getRandomAddresses(uint64_t nAddresses) {
+  vector<void *> *randomAddresses = new vector<void *>(min(nAddresses, (uint64_t)addresses->size()));
+  getRandomAddresses(nAddresses, randomAddresses->data());
+  return randomAddresses;
+}
+
+void AddressGroup::selectCachedRepresentatives() {
+  // Candidates are measured against each other. A candidate that was added to
+  // the group by mistake does not conflict with the others, so only candidates
+  // that conflict with more than half of the other candidates are kept.
+  uint64_t threshold = getRowConflictThreshold();
+  vector<void *> *candidates = getRandomAddresses(nCompareAddresses * CANDIDATES_PER_REPRESENTATIVE);
+  vector<uint64_t> nConflicts(candidates->size(), 0);
+  for(uint64_t i = 0; i < candidates->size(); i++) {
+    for(uint64_t j = i + 1; j < candidates->size(); j++) {
+      if(measureAccessTime((*candidates)[i], (*candidates)[j], nMeasurementsPerComparison, fenced) >= threshold) {
+        nConflicts[i]++;
+        nConflicts[j]++;
+      }
+    }
   }
-  delete indices;
 
-  sort(accessTimes.begin(), accessTimes.end(), greater<int>());
+  cachedRepresentatives->clear();
+  for(uint64_t i = 0; i < candidates->size() && cachedRepresentatives->size() < nCompareAddresses; i++) {
+    if(2 * nConflicts[i] > candidates->size() - 1) {
+      cachedRepresentatives->push_back((*candidates)[i]);
+    }
+  }
+  if(cachedRepresentatives->size() < nCompareAddresses) {
+    printLogMessage(LOG_DEBUG, "Only " + to_string(cachedRepresentatives->size()) + " of " + to_string(candidates->size()) + " candidates conflict with each other, the representatives are not cached.");
+    cachedRepresentatives->clear();
+  }
+  nAddressesAtCaching = addresses->size();
+  delete candidates;
+}
 
-  return accessTimes[accessTimes.size()/2];
+uint64_t AddressGroup::getRepresentatives(uint64_t nRepresentatives, void **representatives) {
+  // Small groups are sampled directly, the cache is used once there are enough
+  // candidates and is renewed whenever the group doubled in size.
+  if(!cacheRepresentatives || addresses->size() < nRepresentatives * CANDIDATES_PER_REPRESENTATIVE) {
+    return getRandomAddresses(nRepresentatives, representatives);
+  }
+  cachedRepresentativesMutex->lock();
+  if(nAddressesAtCaching == 0 || addresses->size() >= 2 * nAddressesAtCaching) {
+    selectCachedRepresentatives();
+  }
+  if(cachedRepresentatives->empty()) {
+    cachedRepresentativesMutex->unlock();
+    return getRandomAddresses(nRepresentatives, representatives);
+  }
+  uint64_t nCachedRepresentatives = min(nRepresentatives, (uint64_t)cachedRepresentatives->size());
+  copy(cachedRepresentatives->begin(), cachedRepresentatives->begin() + nCachedRepresentatives, representatives);
+  cachedRepresentativesMutex->unlock();
+  return nCachedRepresentatives;
 }
 
 vector<void *> *AddressGroup::getAddresses() {
   return addresses;
 }
 
+void AddressGroup::setAddresses(vector<void *> *newAddresses) {
+  *addresses = *newAddresses;
+  clearCachedRepresentatives();
+}
+
+void AddressGroup::clearCachedRepresentatives() {
+  cachedRepresentativesMutex->lock();
+  cachedRepresentatives->clear();
+  nAddressesAtCaching = 0;
+  cachedRepresentativesMutex->unlock();
+}
+
 void AddressGroup::print(string prefix, bool listAddresses) {
   printf("%sThe address group contains %ld addresses.\n", prefix.c_str(), addresses->size());
   if(listAddresses) {
@@ -4,8 +4,10 @@
 #include<cstdint>
 #include<string>
 #include<vector>
+#include<mutex>
 #include<unistd.h>
 #include "config.h"
+#include "thresholdMonitor.h"
 
 using namespace std;
 
@@ -16,15 +18,30 @@ class AddressGroup {
     uint64_t nCompareAddresses;
     uint64_t nMeasurementsPerComparison;
     bool fenced;
+    uint64_t rowConflictThreshold;
+    uint64_t sequentialTimingConfidence;
+    ThresholdMonitor *thresholdMonitor;
+    bool cacheRepresentatives;
+    vector<void *> *cachedRepresentatives;
+    uint64_t nAddressesAtCaching;
+    mutex *cachedRepresentativesMutex;
+    uint64_t getRowConflictThreshold();
+    void selectCachedRepresentatives();
+    void clearCachedRepresentatives();
+    uint64_t getRepresentatives(uint64_t nRepresentatives, void **representatives);
+    uint64_t compareAddressTimingSequential(void *address, uint64_t *nMeasurements);
   public:
-    AddressGroup(Config *config);
+    AddressGroup(Config *config, ThresholdMonitor *thresholdMonitor = NULL);
     ~AddressGroup();
     void addAddressToGroup(void *address);
     uint64_t getNumberOfAddresses();
     uint64_t getBlockSize();
     void setBlockSize(uint64_t newBlockSize);
-    uint64_t compareAddressTiming(void *address);
+    uint64_t compareAddressTiming(void *address, uint64_t *nMeasurements = NULL);
+    uint64_t getRandomAddresses(uint64_t nAddresses, void **randomAddresses);
+    vector<void *> *getRandomAddresses(uint64_t nAddresses);
     vector<void *> *getAddresses();
+    void setAddresses(vector<void *> *newAddresses);
     void print(string prefix, bool listAddresses = false);
 };
 
@@ -5,17 +5,30 @@
 #include<fcntl.h>
 #include<string.h>
 #include<errno.h>
+#include<sys/wait.h>
+#include<algorithm>
 
 #include "amdre.h"
 #include "helper.h"
 #include "bankGroup.h"
 #include "addressFunction.h"
+#include "linearSolver.h"
+#include "dataset.h"
 #include "config.h"
 
 int main(int argc, char * argv[]) {
   Config *config = new Config(argc, argv);
   setConfigForHelper(config);
 
+  // A saved dataset is solved without measuring
+  if(config->getDatasetPath() != "") {
+    return solveDataset(config, argc, argv);
+  }
+
+  if(config->isTimerCalibrationEnabled()) {
+    calibrateTimer();
+  }
+
 	// Measure the threshold
   if(config->getRowConflictThreshold() == 0) {
     measureThreshold();
@@ -32,8 +45,14 @@ int main(int argc, char * argv[]) {
   for(uint64_t i = 0; i < config->getNumberOfInitialTHPs(); i++) {
     updateLogMessage(LOG_DEBUG, "Adding THP " + to_string(i + 1) + " of " + to_string(config->getNumberOfInitialTHPs()) + " to the bank group.", logEntryId);
 		mappings.push_back(getTHP());
-		bankGroup->addTHPToBankGroup(mappings[i]);
+    if(config->getGrouping() == GROUPING_GREEDY) {
+      bankGroup->addTHPToBankGroup(mappings[i]);
+    }
 	}
+  // The pivots cluster the addresses of all initial THPs at once
+  if(config->getGrouping() == GROUPING_PIVOT) {
+    bankGroup->addTHPsToBankGroupByPivots(&mappings);
+  }
 
 	// Regroup the bank group until it is a power of 2
   bool banksLookPlausible = false;
@@ -41,8 +60,22 @@ int main(int argc, char * argv[]) {
   logEntryId = printLogMessage(LOG_DEBUG, "");
   uint64_t nRegroup = 0;
   while(!banksLookPlausible) {
+    if(nRegroup == config->getMaximumNumberOfRegroupTries()) {
+      printLogMessage(LOG_ERROR, "The number of banks is still not a power of 2 after " + to_string(nRegroup) + " regrouping tries (" + to_string(bankGroup->getNumberOfBanks()) + " groups).");
+      bankGroup->print("", true);
+      printLogMessage(LOG_ERROR, "Check the threshold (-T), try more initial THPs (-i), another initial block size (-b) or more compared addresses (-c).");
+      exit(EXIT_FAILURE);
+    }
     nRegroup++;
     updateLogMessage(LOG_DEBUG, "Regrouping addresses (try " + to_string(nRegroup) + ").", logEntryId);
+    // Merging groups is much cheaper than regrouping all addresses, so the
+    // addresses are only regrouped when it was not enough.
+    if(config->isGroupConsolidationEnabled()) {
+      bankGroup->consolidateGroups();
+      if(bankGroup->numberOfBanksIsPowerOfTwo()) {
+        break;
+      }
+    }
     bankGroup->regroupAllAddresses();
     banksLookPlausible = bankGroup->numberOfBanksIsPowerOfTwo();
   }
@@ -61,19 +94,72 @@ int main(int argc, char * argv[]) {
 
 	// Add more addresses to the existing groups. No new groups will be created
 	// and no regrouping steps will be performed.
+  //
+  // Optionally, the addresses of each THP are added to a linear system of the
+  // address functions right away. When the system has the expected number of
+  // functions and did not change for some THPs, no more THPs are added.
+  LinearSolver *linearSolver = NULL;
+  vector<uint64_t> nSolvedAddresses;
+  uint64_t nExpectedFunctions = 0;
+  while((1UL<<nExpectedFunctions) < bankGroup->getNumberOfBanks()) {
+    nExpectedFunctions++;
+  }
+  if(config->getNumberOfConvergenceTHPs() > 0) {
+    linearSolver = new LinearSolver(~(bankGroup->getBlockSize() - 1));
+    vector<vector<uint64_t>*> *newPhysicalAddresses = bankGroup->getNewPhysicalAddresses(&nSolvedAddresses);
+    linearSolver->addGroups(newPhysicalAddresses);
+    for(vector<uint64_t> *group : *newPhysicalAddresses) {
+      delete group;
+    }
+    delete newPhysicalAddresses;
+  }
+
   logEntryId = printLogMessage(LOG_DEBUG, "Adding more addresses to the group.");
   uint64_t nErrors = 0;
+  uint64_t nAddedTHPs = 0;
+  uint64_t nUnchangedTHPs = 0;
   for(uint64_t i = config->getNumberOfInitialTHPs(); i < config->getNumberOfAdditionalTHPs() + config->getNumberOfInitialTHPs(); i++) {
     updateLogMessage(LOG_DEBUG, "Adding THP " + to_string(i - config->getNumberOfInitialTHPs() + 1) + " of " + to_string(config->getNumberOfAdditionalTHPs()) + " to bank groups.", logEntryId);
     mappings.push_back(getTHP());
     nErrors += bankGroup->addTHPToExistingBankGroup(mappings[i]);
+    nAddedTHPs++;
+
+    if(linearSolver == NULL) {
+      continue;
+    }
+    vector<vector<uint64_t>*> *newPhysicalAddresses = bankGroup->getNewPhysicalAddresses(&nSolvedAddresses);
+    if(linearSolver->addGroups(newPhysicalAddresses)) {
+      nUnchangedTHPs = 0;
+    } else {
+      nUnchangedTHPs++;
+    }
+    for(vector<uint64_t> *group : *newPhysicalAddresses) {
+      delete group;
+    }
+    delete newPhysicalAddresses;
+
+    // With fewer functions than expected, the groups can not be told apart
+    // anymore, so some addresses are in the wrong group. The system can not
+    // converge anymore, so all THPs are added.
+    if(linearSolver->getNumberOfFunctions() < nExpectedFunctions) {
+      printLogMessage(LOG_WARNING, "The linear system is inconsistent with " + to_string(bankGroup->getNumberOfBanks()) + " banks, adding all additional THPs.");
+      delete linearSolver;
+      linearSolver = NULL;
+    } else if(linearSolver->getNumberOfFunctions() == nExpectedFunctions && nUnchangedTHPs >= config->getNumberOfConvergenceTHPs()) {
+      printLogMessage(LOG_INFO, "The address functions converged after " + to_string(nAddedTHPs) + " additional THPs.");
+      break;
+    }
   }
-  printLogMessage(LOG_INFO, "Additional addresses were added to groups. A total of " + to_string(config->getNumberOfAdditionalTHPs() * config->getPagesPerTHP()) + " pages with " + to_string(nErrors) + " errors.");
+  delete linearSolver;
+  printLogMessage(LOG_INFO, "Additional addresses were added to groups. A total of " + to_string(nAddedTHPs * config->getPagesPerTHP()) + " pages with " + to_string(nErrors) + " errors.");
 
 	// Calculate the address functions based on the groups
   printLogMessage(LOG_INFO, "Calculating address functions. This may take a while.");
   AddressFunction *addressFunction = new AddressFunction(bankGroup, config);
-  if(addressFunction->calculateBitMasks()) {
+  if(config->getDatasetSavePath() != "" && addressFunction->saveDataset(config->getDatasetSavePath())) {
+    printLogMessage(LOG_INFO, "Saved the grouped addresses to " + config->getDatasetSavePath() + ".");
+  }
+  if(addressFunction->calculateBitMasks(config->getNumberOfThreadsForMaskCalculation())) {
     printLogMessage(LOG_INFO, "Address functions calculated successfully.");
   } else {
     printLogMessage(LOG_ERROR, "Failed to calculate address functions.");
@@ -87,3 +173,127 @@ int main(int argc, char * argv[]) {
   delete bankGroup;
 	return EXIT_SUCCESS;
 }
+
+int solveDataset(Config *config, int argc, char *argv[]) {
+  uint64_t blockSize = 0;
+  uint64_t nBanks = 0;
+  vector<vector<uint64_t>*> *physicalAddresses = loadDataset(config->getDatasetPath(), &blockSize, &nBanks);
+  if(physicalAddresses == NULL) {
+    exit(EXIT_FAILURE);
+  }
+  AddressFunction *addressFunction = new AddressFunction(physicalAddresses, blockSize, nBanks, config);
+
+  // A worker only prints the valid masks of its shard, they are combined by
+  // the process that merges all shards.
+  if(config->isShardWorker()) {
+    vector<uint64_t> *validMasks = addressFunction->searchShard(config->getShardIndex(), config->getNumberOfShards(), config->getNumberOfThreadsForMaskCalculation());
+    for(uint64_t mask : *validMasks) {
+      printf("0x%lx\n", mask);
+    }
+    delete validMasks;
+    delete addressFunction;
+    return EXIT_SUCCESS;
+  }
+
+  vector<uint64_t> *validMasks = NULL;
+  if(config->isShardMergeEnabled()) {
+    validMasks = new vector<uint64_t>();
+    for(string shardResultPath : *config->getShardResultPaths()) {
+      vector<uint64_t> *shardMasks = loadMasks(shardResultPath);
+      if(shardMasks == NULL) {
+        exit(EXIT_FAILURE);
+      }
+      validMasks->insert(validMasks->end(), shardMasks->begin(), shardMasks->end());
+      delete shardMasks;
+    }
+    printLogMessage(LOG_INFO, "Merged " + to_string(validMasks->size()) + " valid masks of " + to_string(config->getShardResultPaths()->size()) + " shards.");
+  } else if(config->getNumberOfLocalShards() > 1) {
+    printLogMessage(LOG_INFO, "Calculating address functions with " + to_string(config->getNumberOfLocalShards()) + " worker processes. This may take a while.");
+    validMasks = searchLocalShards(config, argc, argv);
+  } else {
+    printLogMessage(LOG_INFO, "Calculating address functions. This may take a while.");
+    validMasks = addressFunction->searchShard(0, 1, config->getNumberOfThreadsForMaskCalculation());
+  }
+
+  // Shards can report the same mask (e.g. when the linear system is solved)
+  sort(validMasks->begin(), validMasks->end());
+  validMasks->erase(unique(validMasks->begin(), validMasks->end()), validMasks->end());
+
+  bool success = addressFunction->calculateBitMasks(validMasks, config->getNumberOfThreadsForMaskCalculation());
+  delete validMasks;
+  delete addressFunction;
+  if(!success) {
+    printLogMessage(LOG_ERROR, "Failed to calculate address functions.");
+    return EXIT_FAILURE;
+  }
+  printLogMessage(LOG_INFO, "Address functions calculated successfully.");
+  return EXIT_SUCCESS;
+}
+
+vector<uint64_t> *searchLocalShards(Config *config, int argc, char *argv[]) {
+  // Every shard runs in its own process with the same options (except for
+  // --shards). The threads are split between the processes.
+  uint64_t nShards = config->getNumberOfLocalShards();
+  uint64_t nThreads = config->getNumberOfThreadsForMaskCalculation() / nShards;
+  if(nThreads == 0) {
+    nThreads = 1;
+  }
+  string threadsOption = "--threads=" + to_string(nThreads);
+
+  vector<pid_t> workers;
+  vector<FILE *> workerOutputs;
+  for(uint64_t shardIdx = 0; shardIdx < nShards; shardIdx++) {
+    string shardOption = "--solve-shard=" + to_string(shardIdx) + "/" + to_string(nShards);
+    vector<char *> workerArguments;
+    for(int i = 0; i < argc; i++) {
+      if(strncmp(argv[i], "--shards", strlen("--shards")) == 0) {
+        // The value can also be passed as the next argument
+        if(strcmp(argv[i], "--shards") == 0) {
+          i++;
+        }
+        continue;
+      }
+      workerArguments.push_back(argv[i]);
+    }
+    workerArguments.push_back((char *)shardOption.c_str());
+    workerArguments.push_back((char *)threadsOption.c_str());
+    workerArguments.push_back(NULL);
+
+    int pipeFds[2];
+    if(pipe(pipeFds) != 0) {
+      printLogMessage(LOG_ERROR, "Could not create a pipe for worker " + to_string(shardIdx) + ": " + string(strerror(errno)));
+      exit(EXIT_FAILURE);
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid == 0) {
+      dup2(pipeFds[1], STDOUT_FILENO);
+      close(pipeFds[0]);
+      close(pipeFds[1]);
+      execv("/proc/self/exe", workerArguments.data());
+      _exit(EXIT_FAILURE);
+    } else if(pid < 0) {
+      printLogMessage(LOG_ERROR, "Could not start worker " + to_string(shardIdx) + ": " + string(strerror(errno)));
+      exit(EXIT_FAILURE);
+    }
+    close(pipeFds[1]);
+    workers.push_back(pid);
+    workerOutputs.push_back(fdopen(pipeFds[0], "r"));
+  }
+
+  vector<uint64_t> *validMasks = new vector<uint64_t>();
+  for(uint64_t shardIdx = 0; shardIdx < nShards; shardIdx++) {
+    vector<uint64_t> *shardMasks = readMasks(workerOutputs[shardIdx]);
+    fclose(workerOutputs[shardIdx]);
+    int status = 0;
+    waitpid(workers[shardIdx], &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+      printLogMessage(LOG_ERROR, "Worker " + to_string(shardIdx) + " failed.");
+      exit(EXIT_FAILURE);
+    }
+    printLogMessage(LOG_DEBUG, "Worker " + to_string(shardIdx) + " found " + to_string(shardMasks->size()) + " valid masks.");
+    validMasks->insert(validMasks->end(), shardMasks->begin(), shardMasks->end());
+    delete shardMasks;
+  }
+  return validMasks;
+}
@@ -1,4 +1,14 @@
 #ifndef AMDRE_H
 #define AMDRE_H
 
+#include<cstdint>
+#include<vector>
+
+#include "config.h"
+
+using namespace std;
+
+int solveDataset(Config *config, int argc, char *argv[]);
+vector<uint64_t> *searchLocalShards(Config *config, int argc, char *argv[]);
+
 #endif
@@ -64,6 +64,19 @@ static inline int64_t rdtscp() {
     return (d<<32)|a;
 }
 
+/**
+ * lfenceRdtsc waits for all previous instructions with lfence and reads the
+ * time stamp counter with rdtsc afterwards. Unlike rdtscp, later instructions
+ * can not start before the counter is read either.
+ *
+ * @return value of the timestamp counter of the current CPU core
+ */
+static inline int64_t lfenceRdtsc() {
+    int64_t a, d;
+    asm volatile("lfence\n\trdtsc\n\tlfence" : "=a"(a), "=d"(d) : : "memory");
+    return (d<<32)|a;
+}
+
 /**
  * cpuid uses the asm cpuid instruction. This instruction returns information
  * about the CPU. It can also be used to serialize instructions. This is,
@@ -6,8 +6,30 @@
 #include<map>
 
 #include "bankGroup.h"
+#include "pivotClustering.h"
 #include "helper.h"
 
+// Number of rounds the measurements of an address against all groups are
+// split into when they are interleaved
+#define INTERLEAVED_TIMING_ROUNDS 8
+// Groups with less than 1/SMALL_GROUP_FRACTION of the addresses of the median
+// group are dissolved when regrouping with a margin or consolidating
+#define SMALL_GROUP_FRACTION 2
+
+struct GroupPairContext {
+  BankGroup *bankGroup;
+  vector<pair<uint64_t, uint64_t>> *pairs;
+  vector<uint64_t> *times;
+};
+
+struct BankIndexSearchContext {
+  BankGroup *bankGroup;
+  vector<void *> *addresses;
+  vector<int64_t> *bankIndices;
+  vector<uint64_t> *margins;
+  vector<ProbeState> *states;
+};
+
 BankGroup::BankGroup(Config *config) {
   this->addressGroups = new vector<AddressGroup *>();
   this->rowConflictThreshold = config->getRowConflictThreshold();
@@ -17,11 +39,31 @@ BankGroup::BankGroup(Config *config) {
   this->fenced = config->areMemoryFencesEnabled();
   this->maxRetriesForBankIndexSearch = config->getMaximumNumberOfRetriesForBankGrouping();
   this->config = config;
+  this->thresholdMonitor = NULL;
+  this->decisionMargins = new unordered_map<void *, uint64_t>();
+  if(config->isThresholdMonitoringEnabled()) {
+    thresholdMonitor = new ThresholdMonitor(rowConflictThreshold);
+  }
   nInitialTHPs = 0;
+  this->probeState = new ProbeState();
+  probeState->lastBankIndex = -1;
+  probeState->nComparisons = 0;
+  probeState->nComparisonMeasurements = 0;
+  probeState->nProbedAddresses = 0;
+  probeState->nProbeVerificationFailures = 0;
+  this->measurementWorkers = NULL;
+  if(config->getNumberOfMeasurementWorkers() > 1 || !config->getMeasurementCores()->empty()) {
+    measurementWorkers = new MeasurementWorkers(config);
+    measurementWorkers->checkInterference();
+  }
 }
 
 BankGroup::~BankGroup() {
+ delete thresholdMonitor;
  delete addressGroups;
+ delete probeState;
+ delete measurementWorkers;
+ delete decisionMargins;
 }
 
 void BankGroup::addAddressToBankGroup(void *address) {
@@ -33,10 +75,12 @@ bool BankGroup::addAddressToExistingBankGroup(void *address) {
 }
 
 bool BankGroup::addAddressToBankGroup(void *address, bool allowNewGroupCreation) {
-  int64_t bankIndex = getBankIndexForAddress(address);
+  uint64_t margin = 0;
+  int64_t bankIndex = searchBankIndex(address, probeState, &margin);
+  (*decisionMargins)[address] = margin;
   if(bankIndex == -1) {
     if(allowNewGroupCreation) {
-      AddressGroup *newAddressGroup = new AddressGroup(config);
+      AddressGroup *newAddressGroup = new AddressGroup(config, thresholdMonitor);
       newAddressGroup->addAddressToGroup(address);
       addressGroups->push_back(newAddressGroup);
     } else {
@@ -54,6 +98,59 @@ bool BankGroup::addAddressToBankGroup(void *address, bool allowNewGroupCreation)
   return true;
 }
 
+void BankGroup::searchBankIndices(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end) {
+  BankIndexSearchContext *searchContext = (BankIndexSearchContext *)context;
+  ProbeState *state = &(*searchContext->states)[workerIdx];
+  for(uint64_t i = begin; i < end; i++) {
+    (*searchContext->bankIndices)[i] = searchContext->bankGroup->searchBankIndex((*searchContext->addresses)[i], state, &(*searchContext->margins)[i]);
+  }
+}
+
+uint64_t BankGroup::addAddressesToBankGroup(vector<void *> *addresses, bool allowNewGroupCreation) {
+  uint64_t nErrors = 0;
+  if(measurementWorkers == NULL) {
+    for(void *address : *addresses) {
+      if(!addAddressToBankGroup(address, allowNewGroupCreation)) {
+        nErrors++;
+      }
+    }
+    return nErrors;
+  }
+
+  // The workers measure the addresses against the existing groups, each one
+  // a contiguous range with its own probe history. The groups do not change
+  // until all workers are done.
+  vector<int64_t> bankIndices(addresses->size(), -1);
+  vector<uint64_t> margins(addresses->size(), 0);
+  ProbeState workerState = *probeState;
+  workerState.lastBankIndex = -1;
+  workerState.nComparisons = 0;
+  workerState.nComparisonMeasurements = 0;
+  workerState.nProbedAddresses = 0;
+  workerState.nProbeVerificationFailures = 0;
+  vector<ProbeState> states(measurementWorkers->getNumberOfWorkers(), workerState);
+  BankIndexSearchContext context = {this, addresses, &bankIndices, &margins, &states};
+  measurementWorkers->run(addresses->size(), searchBankIndices, &context);
+  for(ProbeState &state : states) {
+    probeState->nComparisons += state.nComparisons;
+    probeState->nComparisonMeasurements += state.nComparisonMeasurements;
+    probeState->nProbedAddresses += state.nProbedAddresses;
+    probeState->nProbeVerificationFailures += state.nProbeVerificationFailures;
+  }
+
+  // Addresses without a group are measured again one after another, since
+  // they might belong to a group that is created for one of them.
+  for(uint64_t i = 0; i < addresses->size(); i++) {
+    if(bankIndices[i] != -1) {
+      (*addressGroups)[bankIndices[i]]->addAddressToGroup((*addresses)[i]);
+      (*decisionMargins)[(*addresses)[i]] = margins[i];
+    } else if(!allowNewGroupCreation || !addAddressToBankGroup((*addresses)[i], true)) {
+      nErrors++;
+    }
+  }
+  return nErrors;
+}
+
 void BankGroup::addTHPToBankGroup(void *address) {
   addTHPToBankGroup(address, true);
 }
@@ -66,49 +163,511 @@ uint64_t BankGroup::addTHPToBankGroup(void *address, bool allowNewGroupCreation)
   nInitialTHPs++;
   uint64_t nErrors = 0;
   uint64_t logEntryId = printLogMessage(LOG_DEBUG, "Add THP to banks...");
-  for(uint64_t i = config->getStartOffset(); i < (config->getEndOffset() * sysconf(_SC_PAGESIZE)) / blockSize; i++) {
-    if(!addAddressToBankGroup((void *)((volatile char *)address + i * blockSize), allowNewGroupCreation)) {
-      nErrors++;
+  // The first block of a THP does not follow the last block of the previous
+  // THP.
+  resetProbeHistory();
+  if(measurementWorkers != NULL) {
+    vector<void *> addresses;
+    for(uint64_t i = config->getStartOffset(); i < (config->getEndOffset() * sysconf(_SC_PAGESIZE)) / blockSize; i++) {
+      addresses.push_back((void *)((volatile char *)address + i * blockSize));
+    }
+    nErrors = addAddressesToBankGroup(&addresses, allowNewGroupCreation);
+  } else {
+    for(uint64_t i = config->getStartOffset(); i < (config->getEndOffset() * sysconf(_SC_PAGESIZE)) / blockSize; i++) {
+      if(!addAddressToBankGroup((void *)((volatile char *)address + i * blockSize), allowNewGroupCreation)) {
+        nErrors++;
+      }
+      updateLogMessage(LOG_DEBUG, "Added address " + to_string(i + 1) + " of " + to_string((config->getPagesPerTHP() * sysconf(_SC_PAGESIZE)) / blockSize), logEntryId);
     }
-		updateLogMessage(LOG_DEBUG, "Added address " + to_string(i + 1) + " of " + to_string((config->getPagesPerTHP() * sysconf(_SC_PAGESIZE)) / blockSize), logEntryId);
   }
 	updateLogMessage(LOG_DEBUG, "Added all addresses of the THP to the banks. There are " + to_string(addressGroups->size()) + " groups now.", logEntryId);
+  printComparisonStatistics();
   return nErrors;
 }
 
 
+vector<uint64_t> *BankGroup::compareAddressTimingInterleaved(void *address) {
+  // The representatives of all groups are measured round-robin, each round
+  // only does a part of the measurements. Noise that lasts for a while is then
+  // spread over all groups instead of hitting the measurements of one group.
+  vector<void *> representatives;
+  vector<uint64_t> representativeGroups;
+  for(uint64_t idx = 0; idx < addressGroups->size(); idx++) {
+    vector<void *> *groupRepresentatives = (*addressGroups)[idx]->getRandomAddresses(nCompareAddresses);
+    for(void *representative : *groupRepresentatives) {
+      representatives.push_back(representative);
+      representativeGroups.push_back(idx);
+    }
+    delete groupRepresentatives;
+  }
+
+  uint64_t nRounds = min((uint64_t)INTERLEAVED_TIMING_ROUNDS, nMeasurementsPerComparison);
+  uint64_t nMeasurementsPerRound = nMeasurementsPerComparison / nRounds;
+  vector<vector<uint64_t>> roundTimes(representatives.size());
+  for(uint64_t round = 0; round < nRounds; round++) {
+    // Every round starts at another representative, so no representative is
+    // always measured right after the same one.
+    for(uint64_t i = 0; i < representatives.size(); i++) {
+      uint64_t representativeIdx = (i + round) % representatives.size();
+      uint64_t time = measureAccessTime(representatives[representativeIdx], address, nMeasurementsPerRound, fenced);
+      roundTimes[representativeIdx].push_back(time);
+      if(thresholdMonitor != NULL) {
+        thresholdMonitor->addTime(time);
+      }
+    }
+  }
+
+  // Like compareAddressTiming, the time of a group is the median of its
+  // representatives. The time of a representative is the median of its rounds.
+  vector<vector<uint64_t>> groupTimes(addressGroups->size());
+  for(uint64_t i = 0; i < representatives.size(); i++) {
+    sort(roundTimes[i].begin(), roundTimes[i].end(), greater<uint64_t>());
+    groupTimes[representativeGroups[i]].push_back(roundTimes[i][roundTimes[i].size()/2]);
+  }
+  vector<uint64_t> *times = new vector<uint64_t>();
+  for(vector<uint64_t> &representativeTimes : groupTimes) {
+    sort(representativeTimes.begin(), representativeTimes.end(), greater<uint64_t>());
+    times->push_back(representativeTimes.empty() ? 0 : representativeTimes[representativeTimes.size()/2]);
+  }
+  return times;
+}
+
+void BankGroup::printComparisonStatistics() {
+  // The sequential test uses a different number of measurements for every
+  // comparison, so the average since the last report is logged.
+  if(config->getSequentialTimingConfidence() > 0 && probeState->nComparisons > 0) {
+    printLogMessage(LOG_DEBUG, "The sequential test used " + to_string(probeState->nComparisonMeasurements / probeState->nComparisons) + " measurements per comparison on average (" + to_string(probeState->nComparisons) + " comparisons).");
+  }
+  if(config->getProbeMargin() > 0 && probeState->nProbedAddresses > 0) {
+    printLogMessage(LOG_DEBUG, "Probing compared each address with " + to_string((double)probeState->nComparisons / probeState->nProbedAddresses) + " groups on average, " + to_string(probeState->nProbeVerificationFailures) + " verifications failed.");
+  }
+  probeState->nComparisons = 0;
+  probeState->nComparisonMeasurements = 0;
+  probeState->nProbedAddresses = 0;
+  probeState->nProbeVerificationFailures = 0;
+}
+
+vector<uint64_t> *BankGroup::getProbeOrder(ProbeState *state) {
+  // Consecutive blocks follow the bank pattern, so the group that followed the
+  // group of the previous block last time is the most likely one, followed by
+  // the group of the previous block itself.
+  vector<uint64_t> *probeOrder = new vector<uint64_t>();
+  vector<bool> added(addressGroups->size(), false);
+  int64_t lastBankIndex = state->lastBankIndex;
+  if(lastBankIndex >= 0 && lastBankIndex < (int64_t)addressGroups->size() && lastBankIndex < (int64_t)state->nextBankIndices.size()) {
+    int64_t predictedBankIndex = state->nextBankIndices[lastBankIndex];
+    if(predictedBankIndex >= 0 && predictedBankIndex < (int64_t)addressGroups->size()) {
+      probeOrder->push_back(predictedBankIndex);
+      added[predictedBankIndex] = true;
+    }
+    if(!added[lastBankIndex]) {
+      probeOrder->push_back(lastBankIndex);
+      added[lastBankIndex] = true;
+    }
+  }
+  for(uint64_t idx = 0; idx < addressGroups->size(); idx++) {
+    if(!added[idx]) {
+      probeOrder->push_back(idx);
+    }
+  }
+  return probeOrder;
+}
+
+void BankGroup::updateProbeHistory(ProbeState *state, int64_t bankIndex) {
+  state->nextBankIndices.resize(addressGroups->size(), -1);
+  if(state->lastBankIndex >= 0 && state->lastBankIndex < (int64_t)state->nextBankIndices.size() && bankIndex >= 0) {
+    state->nextBankIndices[state->lastBankIndex] = bankIndex;
+  }
+  state->lastBankIndex = bankIndex;
+}
+
+void BankGroup::resetProbeHistory() {
+  probeState->lastBankIndex = -1;
+  probeState->nextBankIndices.assign(addressGroups->size(), -1);
+}
+
+uint64_t BankGroup::getRowConflictThreshold() {
+  if(thresholdMonitor != NULL) {
+    return thresholdMonitor->getThreshold();
+  }
+  return rowConflictThreshold;
+}
+
 int64_t BankGroup::getBankIndexForAddress(void *address) {
+  return searchBankIndex(address, probeState);
+}
+
+int64_t BankGroup::searchBankIndex(void *address, ProbeState *state, uint64_t *margin) {
+  // With a probe margin, the groups are measured in the order of their
+  // likelihood and the search stops at the first group that is clearly above
+  // the threshold (optionally after checking the next group as well).
+  //
+  // The margin of the decision is the distance between the time of the chosen
+  // group and the time of the runner-up. Groups that were not measured count
+  // as being at the threshold.
+  uint64_t probeMargin = config->getProbeMargin();
+  uint64_t threshold = getRowConflictThreshold();
+  bool probe = probeMargin > 0 && !config->isInterleavedTimingEnabled();
+
   for(uint64_t i = 0; i < maxRetriesForBankIndexSearch + 1; i++) {
     uint64_t biggestTime = 0;
     int64_t biggestTimeIdx = -1;
-    for(uint64_t idx = 0; idx < addressGroups->size(); idx++) {
+    uint64_t runnerUpTime = 0;
+    uint64_t nMeasuredGroups = 0;
+    vector<uint64_t> *interleavedTimes = NULL;
+    if(config->isInterleavedTimingEnabled()) {
+      interleavedTimes = compareAddressTimingInterleaved(address);
+    }
+    vector<uint64_t> *probeOrder = getProbeOrder(state);
+    bool confident = false;
+    for(uint64_t probeIdx = 0; probeIdx < probeOrder->size(); probeIdx++) {
+      uint64_t idx = (*probeOrder)[probeIdx];
       AddressGroup *group = (*addressGroups)[idx];
-      uint64_t time = group->compareAddressTiming(address);
-      if(time >= rowConflictThreshold && time > biggestTime) {
-        //printf("[DEBUG]: Measured access time %ld >= %ld against group %ld with %ld measurements.\n", time, rowConflictThreshold, idx, nMeasurementsPerComparison);
+      uint64_t time = 0;
+      if(interleavedTimes != NULL) {
+        time = (*interleavedTimes)[idx];
+      } else {
+        uint64_t nMeasurements = 0;
+        time = group->compareAddressTiming(address, &nMeasurements);
+        state->nComparisons++;
+        state->nComparisonMeasurements += nMeasurements;
+      }
+      nMeasuredGroups++;
+      if(time >= threshold && time > biggestTime) {
+        //printf("[DEBUG]: Measured access time %ld >= %ld against group %ld with %ld measurements.\n", time, threshold, idx, nMeasurementsPerComparison);
+        runnerUpTime = max(runnerUpTime, biggestTime);
         biggestTime = time;
         biggestTimeIdx = idx;
+      } else if(time > runnerUpTime) {
+        runnerUpTime = time;
+      }
+
+      if(!probe) {
+        continue;
+      }
+      if(confident) {
+        // Verification: the next group has to be below the threshold,
+        // otherwise all groups are measured.
+        if(time >= threshold) {
+          confident = false;
+          probe = false;
+          state->nProbeVerificationFailures++;
+          continue;
+        }
+        break;
+      }
+      if(time >= threshold + probeMargin) {
+        confident = true;
+        if(!config->isProbeVerificationEnabled() || probeIdx + 1 == probeOrder->size()) {
+          break;
+        }
       }
     }
+    delete probeOrder;
+    delete interleavedTimes;
     if(biggestTimeIdx != -1) {
+      if(nMeasuredGroups < addressGroups->size()) {
+        runnerUpTime = max(runnerUpTime, threshold);
+      }
+      if(margin != NULL) {
+        *margin = biggestTime - runnerUpTime;
+      }
+      state->nProbedAddresses++;
+      updateProbeHistory(state, biggestTimeIdx);
       return biggestTimeIdx;
     }
   }
+  if(margin != NULL) {
+    *margin = 0;
+  }
+  state->nProbedAddresses++;
+  updateProbeHistory(state, -1);
   return -1;
 }
 
 void BankGroup::regroupAllAddresses() {
+  if(config->getGrouping() == GROUPING_PIVOT) {
+    // All addresses are clustered again with new pivots
+    vector<void *> *pivots = selectGroupPivots();
+    vector<void *> addresses;
+    for(AddressGroup *group : *addressGroups) {
+      addresses.insert(addresses.end(), group->getAddresses()->begin(), group->getAddresses()->end());
+      delete group;
+    }
+    addressGroups->clear();
+    resetProbeHistory();
+    sort(addresses.begin(), addresses.end(), less<void *>());
+    groupAddressesByPivots(&addresses, pivots);
+    delete pivots;
+    return;
+  }
+  if(config->getRegroupMargin() > 0) {
+    regroupLowMarginAddresses();
+    printComparisonStatistics();
+    return;
+  }
   uint64_t addressGroupSize = addressGroups->size();
   uint64_t logEntryId = printLogMessage(LOG_DEBUG, "Regrouping...");
   for(uint64_t idx = 0; idx < addressGroupSize; idx++) {
 		updateLogMessage(LOG_DEBUG, "Regrouping " + to_string(idx + 1) + " of " + to_string(addressGroupSize), logEntryId);
     AddressGroup *group = (*addressGroups)[0];
     addressGroups->erase(addressGroups->begin());
-    for(void *address : *(group->getAddresses())) {
-      addAddressToBankGroup(address);
+    // The indices of all groups changed
+    resetProbeHistory();
+    vector<void *> *addresses = group->getAddresses();
+    if(measurementWorkers == NULL || addresses->empty()) {
+      for(void *address : *addresses) {
+        addAddressToBankGroup(address);
+      }
+    } else {
+      // The first address creates the group again (or joins another one), so
+      // the other addresses can be measured against it in parallel.
+      addAddressToBankGroup((*addresses)[0]);
+      vector<void *> remainingAddresses(addresses->begin() + 1, addresses->end());
+      addAddressesToBankGroup(&remainingAddresses, true);
     }
   }
   updateLogMessage(LOG_DEBUG, "Regrouping done. There are " + to_string(addressGroups->size()) + " groups now.", logEntryId);
+  printComparisonStatistics();
+}
+
+void BankGroup::regroupLowMarginAddresses() {
+  // Addresses that were clearly closer to their group than to any other group
+  // stay where they are. Only the other addresses and all addresses of groups
+  // that are much smaller than the median group are measured again.
+  uint64_t regroupMargin = config->getRegroupMargin();
+  uint64_t smallGroupSize = getSmallGroupSize();
+  uint64_t nAddresses = 0;
+  vector<void *> pendingAddresses;
+  vector<AddressGroup *> *keptGroups = new vector<AddressGroup *>();
+  for(AddressGroup *group : *addressGroups) {
+    vector<void *> *addresses = group->getAddresses();
+    nAddresses += addresses->size();
+    if(addresses->size() < smallGroupSize) {
+      pendingAddresses.insert(pendingAddresses.end(), addresses->begin(), addresses->end());
+      delete group;
+      continue;
+    }
+    vector<void *> keptAddresses;
+    for(void *address : *addresses) {
+      auto margin = decisionMargins->find(address);
+      if(margin != decisionMargins->end() && margin->second >= regroupMargin) {
+        keptAddresses.push_back(address);
+      } else {
+        pendingAddresses.push_back(address);
+      }
+    }
+    if(keptAddresses.empty()) {
+      delete group;
+      continue;
+    }
+    group->setAddresses(&keptAddresses);
+    keptGroups->push_back(group);
+  }
+  delete addressGroups;
+  addressGroups = keptGroups;
+  resetProbeHistory();
+
+  // In the order of the memory, the probe history predicts the groups again
+  sort(pendingAddresses.begin(), pendingAddresses.end(), less<void *>());
+  printLogMessage(LOG_DEBUG, "Regrouping " + to_string(pendingAddresses.size()) + " of " + to_string(nAddresses) + " addresses (" + to_string(keptGroups->size()) + " groups kept).");
+  addAddressesToBankGroup(&pendingAddresses, true);
+}
+
+void BankGroup::addTHPsToBankGroupByPivots(vector<void *> *thps) {
+  // All THPs are clustered at once, the pivots are taken from all of them
+  vector<void *> addresses;
+  for(void *thp : *thps) {
+    nInitialTHPs++;
+    for(uint64_t i = config->getStartOffset(); i < (config->getEndOffset() * sysconf(_SC_PAGESIZE)) / blockSize; i++) {
+      addresses.push_back((void *)((volatile char *)thp + i * blockSize));
+    }
+  }
+  resetProbeHistory();
+  groupAddressesByPivots(&addresses, NULL);
+}
+
+vector<void *> *BankGroup::selectGroupPivots() {
+  // Random pivots can miss a bank. When regrouping, the pivots are taken from
+  // all groups in turn instead, so every group has at least one (if there are
+  // enough pivots).
+  vector<vector<void *>*> groupPivots;
+  uint64_t nPivotsPerGroup = addressGroups->empty() ? 0 : (config->getNumberOfPivots() + addressGroups->size() - 1) / addressGroups->size();
+  for(AddressGroup *group : *addressGroups) {
+    groupPivots.push_back(group->getRandomAddresses(nPivotsPerGroup));
+  }
+  vector<void *> *pivots = new vector<void *>();
+  for(uint64_t i = 0; i < nPivotsPerGroup; i++) {
+    for(vector<void *> *group : groupPivots) {
+      if(i < group->size() && pivots->size() < config->getNumberOfPivots()) {
+        pivots->push_back((*group)[i]);
+      }
+    }
+  }
+  for(vector<void *> *group : groupPivots) {
+    delete group;
+  }
+  return pivots;
+}
+
+void BankGroup::groupAddressesByPivots(vector<void *> *addresses, vector<void *> *pivots) {
+  // Addresses the pivots could not assign (e.g. of a bank without pivot) are
+  // grouped one by one, which also creates the groups of such banks.
+  PivotClustering *pivotClustering = new PivotClustering(config, measurementWorkers, getRowConflictThreshold());
+  vector<void *> unassignedAddresses;
+  vector<vector<void *>*> *clusters = pivotClustering->cluster(addresses, pivots, &unassignedAddresses);
+  for(vector<void *> *cluster : *clusters) {
+    AddressGroup *group = new AddressGroup(config, thresholdMonitor);
+    group->setAddresses(cluster);
+    addressGroups->push_back(group);
+    delete cluster;
+  }
+  printLogMessage(LOG_DEBUG, "Clustered " + to_string(addresses->size()) + " addresses with " + to_string(pivotClustering->getNumberOfPivots()) + " pivots into " + to_string(clusters->size()) + " groups, " + to_string(unassignedAddresses.size()) + " addresses are grouped one by one.");
+  delete clusters;
+  delete pivotClustering;
+
+  resetProbeHistory();
+  addAddressesToBankGroup(&unassignedAddresses, true);
+  printComparisonStatistics();
+}
+
+uint64_t BankGroup::getSmallGroupSize() {
+  // Wrong groups are small but can be many, so the median is taken over the
+  // groups of all addresses (weighted by the size of the groups).
+  vector<uint64_t> groupSizes;
+  for(AddressGroup *group : *addressGroups) {
+    groupSizes.insert(groupSizes.end(), group->getNumberOfAddresses(), group->getNumberOfAddresses());
+  }
+  if(groupSizes.empty()) {
+    return 0;
+  }
+  nth_element(groupSizes.begin(), groupSizes.begin() + groupSizes.size()/2, groupSizes.end());
+  return (groupSizes[groupSizes.size()/2] + SMALL_GROUP_FRACTION - 1) / SMALL_GROUP_FRACTION;
+}
+
+static uint64_t findGroupSet(vector<uint64_t> *parents, uint64_t idx) {
+  while((*parents)[idx] != idx) {
+    (*parents)[idx] = (*parents)[(*parents)[idx]];
+    idx = (*parents)[idx];
+  }
+  return idx;
+}
+
+void BankGroup::compareGroupPairs(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end) {
+  // The time of a pair is the median of random addresses of both groups
+  // measured against each other, like the time of an address and a group.
+  GroupPairContext *pairContext = (GroupPairContext *)context;
+  BankGroup *bankGroup = pairContext->bankGroup;
+  for(uint64_t i = begin; i < end; i++) {
+    AddressGroup *first = (*bankGroup->addressGroups)[(*pairContext->pairs)[i].first];
+    AddressGroup *second = (*bankGroup->addressGroups)[(*pairContext->pairs)[i].second];
+    vector<void *> *firstAddresses = first->getRandomAddresses(bankGroup->nCompareAddresses);
+    vector<void *> *secondAddresses = second->getRandomAddresses(bankGroup->nCompareAddresses);
+    // Small groups are measured with all of their addresses several times
+    uint64_t nTimes = max(firstAddresses->size(), secondAddresses->size());
+    vector<uint64_t> times;
+    for(uint64_t j = 0; j < nTimes; j++) {
+      times.push_back(measureAccessTime((*firstAddresses)[j % firstAddresses->size()], (*secondAddresses)[j % secondAddresses->size()], bankGroup->nMeasurementsPerComparison, bankGroup->fenced));
+    }
+    delete firstAddresses;
+    delete secondAddresses;
+    nth_element(times.begin(), times.begin() + times.size()/2, times.end(), greater<uint64_t>());
+    (*pairContext->times)[i] = times[times.size()/2];
+  }
+}
+
+void BankGroup::consolidateGroups() {
+  // Instead of measuring every address against every group again, the groups
+  // are measured against each other. Groups that conflict belong to the same
+  // bank and are merged (union-find, so chains of conflicts end up in one
+  // group). Very small groups often contain addresses of several banks and
+  // would chain different banks together, so they are not merged by their
+  // conflicts but dissolved into the group they match best.
+  uint64_t threshold = getRowConflictThreshold();
+  uint64_t nGroups = addressGroups->size();
+  uint64_t smallGroupSize = getSmallGroupSize();
+  vector<pair<uint64_t, uint64_t>> pairs;
+  for(uint64_t i = 0; i < nGroups; i++) {
+    for(uint64_t j = i + 1; j < nGroups; j++) {
+      pairs.push_back(make_pair(i, j));
+    }
+  }
+  vector<uint64_t> times(pairs.size(), 0);
+  GroupPairContext context = {this, &pairs, &times};
+  if(measurementWorkers != NULL) {
+    measurementWorkers->run(pairs.size(), compareGroupPairs, &context);
+  } else {
+    compareGroupPairs(&context, 0, 0, pairs.size());
+  }
+
+  vector<uint64_t> parents(nGroups);
+  for(uint64_t i = 0; i < nGroups; i++) {
+    parents[i] = i;
+  }
+  uint64_t nMerges = 0;
+  // nGroups marks groups without a match
+  vector<uint64_t> bestMatches(nGroups, nGroups);
+  vector<uint64_t> bestMatchTimes(nGroups, 0);
+  for(uint64_t i = 0; i < pairs.size(); i++) {
+    uint64_t firstIdx = pairs[i].first;
+    uint64_t secondIdx = pairs[i].second;
+    bool firstIsSmall = (*addressGroups)[firstIdx]->getNumberOfAddresses() < smallGroupSize;
+    bool secondIsSmall = (*addressGroups)[secondIdx]->getNumberOfAddresses() < smallGroupSize;
+    if(firstIsSmall && !secondIsSmall && times[i] >= bestMatchTimes[firstIdx]) {
+      bestMatches[firstIdx] = secondIdx;
+      bestMatchTimes[firstIdx] = times[i];
+    }
+    if(secondIsSmall && !firstIsSmall && times[i] >= bestMatchTimes[secondIdx]) {
+      bestMatches[secondIdx] = firstIdx;
+      bestMatchTimes[secondIdx] = times[i];
+    }
+    if(firstIsSmall || secondIsSmall || times[i] < threshold) {
+      continue;
+    }
+    uint64_t first = findGroupSet(&parents, firstIdx);
+    uint64_t second = findGroupSet(&parents, secondIdx);
+    if(first != second) {
+      // The bigger group is kept, so fewer addresses are moved
+      if((*addressGroups)[first]->getNumberOfAddresses() < (*addressGroups)[second]->getNumberOfAddresses()) {
+        swap(first, second);
+      }
+      parents[second] = first;
+      nMerges++;
+    }
+  }
+  uint64_t nDissolvedGroups = 0;
+  for(uint64_t i = 0; i < nGroups; i++) {
+    if(bestMatches[i] != nGroups) {
+      parents[i] = bestMatches[i];
+      nDissolvedGroups++;
+    }
+  }
+
+  vector<AddressGroup *> *mergedGroups = new vector<AddressGroup *>();
+  for(uint64_t i = 0; i < nGroups; i++) {
+    uint64_t root = findGroupSet(&parents, i);
+    if(root == i) {
+      continue;
+    }
+    // The moved addresses were never measured against their new group, so
+    // they are measured again by the next regrouping with a margin
+    vector<void *> *addresses = (*addressGroups)[i]->getAddresses();
+    for(void *address : *addresses) {
+      (*addressGroups)[root]->addAddressToGroup(address);
+      decisionMargins->erase(address);
+    }
+    delete (*addressGroups)[i];
+    (*addressGroups)[i] = NULL;
+  }
+  for(AddressGroup *group : *addressGroups) {
+    if(group != NULL) {
+      mergedGroups->push_back(group);
+    }
+  }
+  delete addressGroups;
+  addressGroups = mergedGroups;
+  resetProbeHistory();
+  printLogMessage(LOG_DEBUG, "Consolidated " + to_string(nGroups) + " groups to " + to_string(addressGroups->size()) + " groups (" + to_string(nMerges) + " merges, " + to_string(nDissolvedGroups) + " small groups dissolved).");
 }
 
 uint64_t BankGroup::getNumberOfBanks() {
@@ -129,6 +688,7 @@ void BankGroup::expandBlocks(uint64_t oldBlockSize, uint64_t newBlockSize) {
     uint64_t addressGroupSize = addressGroup->getAddresses()->size();
     uint64_t nNewAddressesPerGroup = 0;
     uint64_t nErrorsPerGroup = 0;
+    vector<void *> newAddresses;
     for(uint64_t addressIdx = 0; addressIdx < addressGroupSize; addressIdx++) {
       void *address = (*addressGroup->getAddresses())[addressIdx];
       if(uint64_t(address) % oldBlockSize != 0) {
@@ -138,13 +698,13 @@ void BankGroup::expandBlocks(uint64_t oldBlockSize, uint64_t newBlockSize) {
       }
 
       for(uint64_t offset = newBlockSize; offset < oldBlockSize; offset+= newBlockSize) {
-        void *newAddress = (void *)((uint64_t)address + offset);
-        if(!addAddressToExistingBankGroup(newAddress)) {
-          nErrorsPerGroup++;
-        }
+        newAddresses.push_back((void *)((uint64_t)address + offset));
         nNewAddressesPerGroup++;
       }
     }
+    // The new addresses of a group are added at once, so the measurement
+    // workers can split them.
+    nErrorsPerGroup += addAddressesToBankGroup(&newAddresses, false);
     nErrors += nErrorsPerGroup;
     nNewAddresses += nNewAddressesPerGroup;
   }
@@ -247,11 +807,21 @@ bool BankGroup::numberOfBanksIsPowerOfTwo() {
 vector<vector<uint64_t>*> *BankGroup::getPhysicalAddresses() {
   vector<vector<uint64_t>*> *groupedPhysicalAddresses = new vector<vector<uint64_t>*>();
   for(AddressGroup *addressGroup : *addressGroups) {
-    vector<uint64_t> *physicalAddresses = new vector<uint64_t>();
-    for(void *address : *(addressGroup->getAddresses())) {
-      physicalAddresses->push_back((uint64_t)getPhysicalAddressForVirtualAddress(address));
-    }
-    groupedPhysicalAddresses->push_back(physicalAddresses);
+    groupedPhysicalAddresses->push_back(getPhysicalAddressesForVirtualAddresses(addressGroup->getAddresses()));
+  }
+  return groupedPhysicalAddresses;
+}
+
+vector<vector<uint64_t>*> *BankGroup::getNewPhysicalAddresses(vector<uint64_t> *nKnownAddresses) {
+  // Addresses are only appended to the groups, so everything behind the known
+  // addresses of a group was added since the last call.
+  nKnownAddresses->resize(addressGroups->size(), 0);
+  vector<vector<uint64_t>*> *groupedPhysicalAddresses = new vector<vector<uint64_t>*>();
+  for(uint64_t groupIdx = 0; groupIdx < addressGroups->size(); groupIdx++) {
+    vector<void *> *addresses = (*addressGroups)[groupIdx]->getAddresses();
+    vector<void *> newAddresses(addresses->begin() + (*nKnownAddresses)[groupIdx], addresses->end());
+    (*nKnownAddresses)[groupIdx] = addresses->size();
+    groupedPhysicalAddresses->push_back(getPhysicalAddressesForVirtualAddresses(&newAddresses));
   }
   return groupedPhysicalAddresses;
 }
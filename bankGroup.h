@@ -4,12 +4,26 @@
 #include<cstdint>
 #include<string>
 #include<vector>
+#include<unordered_map>
 #include<unistd.h>
 
 #include "addressGroup.h"
+#include "measurementWorkers.h"
+#include "thresholdMonitor.h"
 
 using namespace std;
 
+// History of the groups of the last addresses and the statistics of the
+// comparisons. Every measurement worker has its own.
+struct ProbeState {
+  int64_t lastBankIndex;
+  vector<int64_t> nextBankIndices;
+  uint64_t nComparisons;
+  uint64_t nComparisonMeasurements;
+  uint64_t nProbedAddresses;
+  uint64_t nProbeVerificationFailures;
+};
+
 class BankGroup {
   private:
     vector<AddressGroup *> *addressGroups;
@@ -21,10 +35,28 @@ class BankGroup {
     bool fenced;
     uint64_t maxRetriesForBankIndexSearch;
     Config *config;
+    ProbeState *probeState;
+    MeasurementWorkers *measurementWorkers;
+    ThresholdMonitor *thresholdMonitor;
+    unordered_map<void *, uint64_t> *decisionMargins;
+    uint64_t getRowConflictThreshold();
+    void printComparisonStatistics();
+    vector<uint64_t> *getProbeOrder(ProbeState *state);
+    void updateProbeHistory(ProbeState *state, int64_t bankIndex);
+    void resetProbeHistory();
+    int64_t searchBankIndex(void *address, ProbeState *state, uint64_t *margin = NULL);
+    static void searchBankIndices(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end);
     bool addAddressToBankGroup(void *address, bool allowNewGroupCreation);
+    uint64_t addAddressesToBankGroup(vector<void *> *addresses, bool allowNewGroupCreation);
     uint64_t addTHPToBankGroup(void *address, bool allowNewGroupCreation);
+    void regroupLowMarginAddresses();
+    void groupAddressesByPivots(vector<void *> *addresses, vector<void *> *pivots);
+    vector<void *> *selectGroupPivots();
+    uint64_t getSmallGroupSize();
+    static void compareGroupPairs(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end);
     void expandBlocks(uint64_t oldBlockSize, uint64_t newBlockSize);
     void simplifyBlocks(uint64_t oldBlockSize, uint64_t newBlockSize);
+    vector<uint64_t> *compareAddressTimingInterleaved(void *address);
   public:
     BankGroup(Config *config);
     ~BankGroup();
@@ -32,7 +64,9 @@ class BankGroup {
     bool addAddressToExistingBankGroup(void *address);
     void addTHPToBankGroup(void *address);
     uint64_t addTHPToExistingBankGroup(void *address);
+    void addTHPsToBankGroupByPivots(vector<void *> *thps);
     void regroupAllAddresses();
+    void consolidateGroups();
     int64_t getBankIndexForAddress(void *address);
     uint64_t getNumberOfBanks();
     uint64_t getBlockSize();
@@ -42,6 +76,7 @@ class BankGroup {
     void print(string prefix, bool listAddressGroups, bool listAddresses = false);
     bool numberOfBanksIsPowerOfTwo();
     vector<vector<uint64_t>*> *getPhysicalAddresses();
+    vector<vector<uint64_t>*> *getNewPhysicalAddresses(vector<uint64_t> *nKnownAddresses);
     uint64_t guessBlockSize();
 };
 
@@ -0,0 +1,245 @@
+#include<cstdint>
+#include<cstdlib>
+#include<cstring>
+#include<vector>
+#include<random>
+#include<immintrin.h>
+
+#include "bitSlicedAddresses.h"
+
+using namespace std;
+
+// Number of 64 bit words each group is padded to (512 bits)
+#define WORDS_PER_BLOCK 8
+
+__attribute__((target("popcnt")))
+static uint64_t countOnesScalar(const uint64_t **columns, uint64_t nColumns, uint64_t offset, uint64_t nWords, uint64_t *destination) {
+  uint64_t nOnes = 0;
+  for(uint64_t word = offset; word < offset + nWords; word++) {
+    uint64_t parity = 0;
+    for(uint64_t column = 0; column < nColumns; column++) {
+      parity ^= columns[column][word];
+    }
+    if(destination != NULL) {
+      destination[word] = parity;
+    }
+    nOnes += __builtin_popcountl(parity);
+  }
+  return nOnes;
+}
+
+__attribute__((target("avx2,popcnt")))
+static uint64_t countOnesAVX2(const uint64_t **columns, uint64_t nColumns, uint64_t offset, uint64_t nWords, uint64_t *destination) {
+  uint64_t nOnes = 0;
+  alignas(32) uint64_t parities[4];
+  for(uint64_t word = offset; word < offset + nWords; word += 4) {
+    __m256i parity = _mm256_setzero_si256();
+    for(uint64_t column = 0; column < nColumns; column++) {
+      parity = _mm256_xor_si256(parity, _mm256_load_si256((const __m256i *)(columns[column] + word)));
+    }
+    _mm256_store_si256((__m256i *)parities, parity);
+    if(destination != NULL) {
+      _mm256_store_si256((__m256i *)(destination + word), parity);
+    }
+    nOnes += __builtin_popcountl(parities[0]) + __builtin_popcountl(parities[1]) + __builtin_popcountl(parities[2]) + __builtin_popcountl(parities[3]);
+  }
+  return nOnes;
+}
+
+__attribute__((target("avx512f,popcnt")))
+static uint64_t countOnesAVX512(const uint64_t **columns, uint64_t nColumns, uint64_t offset, uint64_t nWords, uint64_t *destination) {
+  uint64_t nOnes = 0;
+  alignas(64) uint64_t parities[8];
+  for(uint64_t word = offset; word < offset + nWords; word += 8) {
+    __m512i parity = _mm512_setzero_si512();
+    for(uint64_t column = 0; column < nColumns; column++) {
+      parity = _mm512_xor_si512(parity, _mm512_load_si512((const void *)(columns[column] + word)));
+    }
+    _mm512_store_si512((void *)parities, parity);
+    if(destination != NULL) {
+      _mm512_store_si512((void *)(destination + word), parity);
+    }
+    for(uint64_t i = 0; i < 8; i++) {
+      nOnes += __builtin_popcountl(parities[i]);
+    }
+  }
+  return nOnes;
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static uint64_t countOnesAVX512PopCnt(const uint64_t **columns, uint64_t nColumns, uint64_t offset, uint64_t nWords, uint64_t *destination) {
+  __m512i nOnes = _mm512_setzero_si512();
+  for(uint64_t word = offset; word < offset + nWords; word += 8) {
+    __m512i parity = _mm512_setzero_si512();
+    for(uint64_t column = 0; column < nColumns; column++) {
+      parity = _mm512_xor_si512(parity, _mm512_load_si512((const void *)(columns[column] + word)));
+    }
+    if(destination != NULL) {
+      _mm512_store_si512((void *)(destination + word), parity);
+    }
+    nOnes = _mm512_add_epi64(nOnes, _mm512_popcnt_epi64(parity));
+  }
+  alignas(64) uint64_t counts[8];
+  _mm512_store_si512((void *)counts, nOnes);
+  return counts[0] + counts[1] + counts[2] + counts[3] + counts[4] + counts[5] + counts[6] + counts[7];
+}
+
+BitSlicedAddresses::BitSlicedAddresses(vector<vector<uint64_t>*> *physicalAddresses) {
+  groupOffsets = new vector<uint64_t>();
+  groupWords = new vector<uint64_t>();
+  groupSizes = new vector<uint64_t>();
+
+  nWords = 0;
+  for(vector<uint64_t> *group : *physicalAddresses) {
+    uint64_t nGroupWords = (group->size() + 63) / 64;
+    nGroupWords = ((nGroupWords + WORDS_PER_BLOCK - 1) / WORDS_PER_BLOCK) * WORDS_PER_BLOCK;
+    groupOffsets->push_back(nWords);
+    groupWords->push_back(nGroupWords);
+    groupSizes->push_back(group->size());
+    nWords += nGroupWords;
+  }
+
+  // Each column starts at a 64 byte boundary, so the vector kernels can use
+  // aligned loads.
+  uint64_t nBytes = 64 * nWords * sizeof(uint64_t);
+  if(nBytes == 0) {
+    nBytes = 64;
+  }
+  columns = (uint64_t *)aligned_alloc(64, nBytes);
+  memset(columns, 0, nBytes);
+
+  // Every address gets a random 64 bit word. Bit j of the signature of a
+  // column is the parity of the column restricted to the addresses with bit j
+  // set in their random word.
+  mt19937_64 generator(0x616d647265);
+  for(uint64_t bit = 0; bit < 64; bit++) {
+    columnSignatures[bit] = 0;
+  }
+  onesSignature = 0;
+
+  for(uint64_t groupIdx = 0; groupIdx < physicalAddresses->size(); groupIdx++) {
+    vector<uint64_t> *group = (*physicalAddresses)[groupIdx];
+    for(uint64_t i = 0; i < group->size(); i++) {
+      uint64_t address = (*group)[i];
+      uint64_t word = (*groupOffsets)[groupIdx] + i / 64;
+      uint64_t projection = generator();
+      onesSignature ^= projection;
+      while(address != 0) {
+        uint64_t bit = __builtin_ctzl(address);
+        columns[bit * nWords + word] |= (1UL<<(i % 64));
+        columnSignatures[bit] ^= projection;
+        address &= address - 1;
+      }
+    }
+  }
+
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) {
+    countOnesKernel = countOnesAVX512PopCnt;
+    kernelName = "AVX-512 (VPOPCNTDQ)";
+  } else if(__builtin_cpu_supports("avx512f")) {
+    countOnesKernel = countOnesAVX512;
+    kernelName = "AVX-512";
+  } else if(__builtin_cpu_supports("avx2")) {
+    countOnesKernel = countOnesAVX2;
+    kernelName = "AVX2";
+  } else {
+    countOnesKernel = countOnesScalar;
+    kernelName = "scalar";
+  }
+}
+
+BitSlicedAddresses::~BitSlicedAddresses() {
+  free(columns);
+  delete groupOffsets;
+  delete groupWords;
+  delete groupSizes;
+}
+
+uint64_t BitSlicedAddresses::getNumberOfGroups() {
+  return groupSizes->size();
+}
+
+uint64_t BitSlicedAddresses::getGroupSize(uint64_t groupIdx) {
+  return (*groupSizes)[groupIdx];
+}
+
+uint64_t BitSlicedAddresses::countOnes(uint64_t mask, uint64_t groupIdx, uint64_t *firstParity) {
+  const uint64_t *maskColumns[64];
+  uint64_t nColumns = 0;
+  while(mask != 0) {
+    maskColumns[nColumns++] = columns + __builtin_ctzl(mask) * nWords;
+    mask &= mask - 1;
+  }
+
+  uint64_t offset = (*groupOffsets)[groupIdx];
+  if(firstParity != NULL) {
+    uint64_t firstWord = 0;
+    for(uint64_t column = 0; column < nColumns; column++) {
+      firstWord ^= maskColumns[column][offset];
+    }
+    *firstParity = firstWord & 1;
+  }
+
+  return countOnesKernel(maskColumns, nColumns, offset, (*groupWords)[groupIdx], NULL);
+}
+
+uint64_t BitSlicedAddresses::getNumberOfWords() {
+  return nWords;
+}
+
+uint64_t BitSlicedAddresses::updateParities(uint64_t *parities, uint64_t mask, uint64_t groupIdx, bool reset, uint64_t *firstParity) {
+  // XOR the columns of all bits in mask into the parities of the group and
+  // count the ones of the result in the same pass. When reset is set, the
+  // parities are overwritten instead.
+  const uint64_t *maskColumns[65];
+  uint64_t nColumns = 0;
+  if(!reset) {
+    maskColumns[nColumns++] = parities;
+  }
+  while(mask != 0) {
+    maskColumns[nColumns++] = columns + __builtin_ctzl(mask) * nWords;
+    mask &= mask - 1;
+  }
+
+  uint64_t offset = (*groupOffsets)[groupIdx];
+  uint64_t nOnes = countOnesKernel(maskColumns, nColumns, offset, (*groupWords)[groupIdx], parities);
+  if(firstParity != NULL) {
+    *firstParity = parities[offset] & 1;
+  }
+  return nOnes;
+}
+
+uint64_t BitSlicedAddresses::countOnesInParities(const uint64_t *parities, uint64_t groupIdx, uint64_t *firstParity) {
+  uint64_t offset = (*groupOffsets)[groupIdx];
+  if(firstParity != NULL) {
+    *firstParity = parities[offset] & 1;
+  }
+  return countOnesKernel(&parities, 1, offset, (*groupWords)[groupIdx], NULL);
+}
+
+bool BitSlicedAddresses::isConstant(uint64_t mask) {
+  bool allZeroes = true;
+  bool allOnes = true;
+  for(uint64_t groupIdx = 0; groupIdx < groupSizes->size(); groupIdx++) {
+    uint64_t nOnes = countOnes(mask, groupIdx);
+    allZeroes = allZeroes && nOnes == 0;
+    allOnes = allOnes && nOnes == (*groupSizes)[groupIdx];
+    if(!allZeroes && !allOnes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t BitSlicedAddresses::getColumnSignature(uint64_t bit) {
+  return columnSignatures[bit];
+}
+
+uint64_t BitSlicedAddresses::getOnesSignature() {
+  return onesSignature;
+}
+
+string BitSlicedAddresses::getKernelName() {
+  return kernelName;
+}
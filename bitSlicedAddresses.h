@@ -0,0 +1,50 @@
+#ifndef BIT_SLICED_ADDRESSES_H
+#define BIT_SLICED_ADDRESSES_H
+
+#include<cstdint>
+#include<string>
+#include<vector>
+
+using namespace std;
+
+/**
+ * BitSlicedAddresses stores grouped physical addresses transposed into one
+ * bitset per address bit (bit column). The parity of a mask for all addresses
+ * is then the XOR of the columns of the bits set in the mask, so a mask can
+ * be evaluated for 64 (or 512 with AVX-512) addresses at once.
+ *
+ * The addresses of each group are stored contiguously and padded with zeroes
+ * to a multiple of 512 bits. Padding does not change the number of ones.
+ *
+ * Additionally, each column is compressed to a 64 bit signature (a random
+ * linear projection over all addresses). The signature of a mask is the XOR of
+ * the signatures of its bits. A mask can only be constant for all addresses
+ * when its signature is zero or the signature of the all-ones column.
+ */
+class BitSlicedAddresses {
+  private:
+    uint64_t nWords;
+    uint64_t *columns;
+    vector<uint64_t> *groupOffsets;
+    vector<uint64_t> *groupWords;
+    vector<uint64_t> *groupSizes;
+    uint64_t (*countOnesKernel)(const uint64_t **columns, uint64_t nColumns, uint64_t offset, uint64_t nWords, uint64_t *destination);
+    string kernelName;
+    uint64_t columnSignatures[64];
+    uint64_t onesSignature;
+  public:
+    BitSlicedAddresses(vector<vector<uint64_t>*> *physicalAddresses);
+    ~BitSlicedAddresses();
+    uint64_t getNumberOfGroups();
+    uint64_t getGroupSize(uint64_t groupIdx);
+    uint64_t countOnes(uint64_t mask, uint64_t groupIdx, uint64_t *firstParity = NULL);
+    uint64_t getNumberOfWords();
+    uint64_t updateParities(uint64_t *parities, uint64_t mask, uint64_t groupIdx, bool reset, uint64_t *firstParity = NULL);
+    uint64_t countOnesInParities(const uint64_t *parities, uint64_t groupIdx, uint64_t *firstParity = NULL);
+    bool isConstant(uint64_t mask);
+    uint64_t getColumnSignature(uint64_t bit);
+    uint64_t getOnesSignature();
+    string getKernelName();
+};
+
+#endif
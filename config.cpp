@@ -3,6 +3,7 @@
 #include<cstdio>
 #include<string.h>
 #include<cinttypes>
+#include<sched.h>
 #include "config.h"
 #include "asm.h"
 
@@ -30,6 +31,38 @@ Config::Config(int argc, char *argv[]) {
     {"pages-per-thp", required_argument, 0, 'P' },
     {"start-offset", required_argument, 0, 'S' },
     {"end-offset", required_argument, 0, 'E' },
+    {"mask-solver", required_argument, 0, 'M' },
+    {"no-bit-pruning", no_argument, 0, OPTION_NO_BIT_PRUNING },
+    {"relevant-bit-bases", required_argument, 0, OPTION_RELEVANT_BIT_BASES },
+    {"mask-order", required_argument, 0, OPTION_MASK_ORDER },
+    {"exhaustive-search", no_argument, 0, OPTION_EXHAUSTIVE_SEARCH },
+    {"sample-size", required_argument, 0, OPTION_SAMPLE_SIZE },
+    {"holdout-percentage", required_argument, 0, OPTION_HOLDOUT_PERCENTAGE },
+    {"bootstrap-samples", required_argument, 0, OPTION_BOOTSTRAP_SAMPLES },
+    {"convergence-thps", required_argument, 0, OPTION_CONVERGENCE_THPS },
+    {"denoise", no_argument, 0, OPTION_DENOISE },
+    {"save-dataset", required_argument, 0, OPTION_SAVE_DATASET },
+    {"solve-shard", required_argument, 0, OPTION_SOLVE_SHARD },
+    {"shards", required_argument, 0, OPTION_SHARDS },
+    {"merge-shards", no_argument, 0, OPTION_MERGE_SHARDS },
+    {"interleaved-timing", no_argument, 0, OPTION_INTERLEAVED_TIMING },
+    {"sequential-timing", required_argument, 0, OPTION_SEQUENTIAL_TIMING },
+    {"probe-margin", required_argument, 0, OPTION_PROBE_MARGIN },
+    {"probe-verify", no_argument, 0, OPTION_PROBE_VERIFY },
+    {"measurement-workers", required_argument, 0, OPTION_MEASUREMENT_WORKERS },
+    {"measurement-cores", required_argument, 0, OPTION_MEASUREMENT_CORES },
+    {"huge-pages", required_argument, 0, OPTION_HUGE_PAGES },
+    {"hugetlbfs-path", required_argument, 0, OPTION_HUGETLBFS_PATH },
+    {"timer", required_argument, 0, OPTION_TIMER },
+    {"calibrate-timer", no_argument, 0, OPTION_CALIBRATE_TIMER },
+    {"threshold-estimator", required_argument, 0, OPTION_THRESHOLD_ESTIMATOR },
+    {"monitor-threshold", no_argument, 0, OPTION_MONITOR_THRESHOLD },
+    {"cache-representatives", no_argument, 0, OPTION_CACHE_REPRESENTATIVES },
+    {"regroup-margin", required_argument, 0, OPTION_REGROUP_MARGIN },
+    {"consolidate-groups", no_argument, 0, OPTION_CONSOLIDATE_GROUPS },
+    {"max-regroup-tries", required_argument, 0, OPTION_MAX_REGROUP_TRIES },
+    {"grouping", required_argument, 0, OPTION_GROUPING },
+    {"pivots", required_argument, 0, OPTION_PIVOTS },
     {0, 0, 0, 0}
   };
 
@@ -37,7 +70,7 @@ Config::Config(int argc, char *argv[]) {
   int option_index = 0;
 
   while (1) {
-    c = getopt_long(argc, argv, "dfhi:a:b:c:m:r:p:t:s:n:x:g:B:T:P:S:E:", long_options, &option_index);
+    c = getopt_long(argc, argv, "dfhi:a:b:c:m:r:p:t:s:n:x:g:B:T:P:S:E:M:", long_options, &option_index);
     if(c == -1) {
       break;
     }
@@ -113,6 +146,183 @@ Config::Config(int argc, char *argv[]) {
       case 'E':
         endOffset = handleNumericalValue(optarg, long_options[option_index].name);
         break;
+      case 'M':
+        if(strcmp(optarg, "brute-force") == 0) {
+          maskSolver = MASK_SOLVER_BRUTE_FORCE;
+        } else if(strcmp(optarg, "linear") == 0) {
+          maskSolver = MASK_SOLVER_LINEAR;
+        } else {
+          printf("Mask solver '%s' not supported.", optarg);
+          exit(-1);
+        }
+        break;
+      case OPTION_NO_BIT_PRUNING:
+        pruneMaskBits = false;
+        break;
+      case OPTION_RELEVANT_BIT_BASES:
+        numberOfRelevantBitBases = handleNumericalValue(optarg, long_options[option_index].name);
+        break;
+      case OPTION_MASK_ORDER:
+        if(strcmp(optarg, "colex") == 0) {
+          maskOrder = MASK_ORDER_COLEX;
+        } else if(strcmp(optarg, "revolving-door") == 0) {
+          maskOrder = MASK_ORDER_REVOLVING_DOOR;
+        } else {
+          printf("Mask order '%s' not supported.", optarg);
+          exit(-1);
+        }
+        break;
+      case OPTION_EXHAUSTIVE_SEARCH:
+        stopSearchEarly = false;
+        break;
+      case OPTION_SAMPLE_SIZE:
+        sampleSize = handleNumericalValue(optarg, long_options[option_index].name);
+        break;
+      case OPTION_HOLDOUT_PERCENTAGE:
+        holdoutPercentage = handleNumericalValue(optarg, long_options[option_index].name);
+        if(holdoutPercentage >= 100) {
+          printLogMessage(LOG_ERROR, "Value " + string(optarg) + " is invalid for parameter " + string(long_options[option_index].name) + ".");
+          printf("\n");
+          printHelpPage(EXIT_FAILURE);
+        }
+        break;
+      case OPTION_BOOTSTRAP_SAMPLES:
+        nBootstrapSamples = handleNumericalValue(optarg, long_options[option_index].name);
+        break;
+      case OPTION_CONVERGENCE_THPS:
+        nConvergenceTHPs = handleNumericalValue(optarg, long_options[option_index].name);
+        break;
+      case OPTION_DENOISE:
+        denoiseAddresses = true;
+        break;
+      case OPTION_SAVE_DATASET:
+        datasetSavePath = optarg;
+        break;
+      case OPTION_SOLVE_SHARD:
+        if(sscanf(optarg, "%" SCNu64 "/%" SCNu64, &shardIdx, &nShards) != 2 || nShards == 0 || shardIdx >= nShards) {
+          printLogMessage(LOG_ERROR, "Value " + string(optarg) + " is invalid for parameter " + string(long_options[option_index].name) + ".");
+          printf("\n");
+          printHelpPage(EXIT_FAILURE);
+        }
+        break;
+      case OPTION_SHARDS:
+        nLocalShards = handleNumericalValue(optarg, long_options[option_index].name);
+        break;
+      case OPTION_MERGE_SHARDS:
+        mergeShards = true;
+        break;
+      case OPTION_INTERLEAVED_TIMING:
+        interleaveTimings = true;
+        break;
+      case OPTION_PROBE_MARGIN:
+        probeMargin = handleNumericalValue(optarg, long_options[option_index].name);
+        break;
+      case OPTION_PROBE_VERIFY:
+        verifyProbes = true;
+        break;
+      case OPTION_SEQUENTIAL_TIMING:
+        sequentialTimingConfidence = handleNumericalValue(optarg, long_options[option_index].name);
+        if(sequentialTimingConfidence >= 100) {
+          printLogMessage(LOG_ERROR, "Value " + string(optarg) + " is invalid for parameter " + string(long_options[option_index].name) + ".");
+          printf("\n");
+          printHelpPage(EXIT_FAILURE);
+        }
+        break;
+      case OPTION_MEASUREMENT_WORKERS:
+        nMeasurementWorkers = handleNumericalValue(optarg, long_options[option_index].name);
+        break;
+      case OPTION_MEASUREMENT_CORES: {
+          // Comma separated list of core numbers (core 0 is valid)
+          char *position = optarg;
+          measurementCores.clear();
+          while(true) {
+            char *end = NULL;
+            uint64_t core = strtoul(position, &end, 10);
+            if(end == position || (*end != ',' && *end != '\0') || core >= CPU_SETSIZE) {
+              printLogMessage(LOG_ERROR, "Value " + string(optarg) + " is invalid for parameter " + string(long_options[option_index].name) + ".");
+              printf("\n");
+              printHelpPage(EXIT_FAILURE);
+            }
+            measurementCores.push_back(core);
+            if(*end == '\0') {
+              break;
+            }
+            position = end + 1;
+          }
+        }
+        break;
+      case OPTION_HUGE_PAGES:
+        if(strcmp(optarg, "thp") == 0) {
+          hugePageType = HUGE_PAGES_THP;
+        } else if(strcmp(optarg, "hugetlb-2m") == 0) {
+          hugePageType = HUGE_PAGES_HUGETLB_2M;
+        } else if(strcmp(optarg, "hugetlb-1g") == 0) {
+          hugePageType = HUGE_PAGES_HUGETLB_1G;
+        } else if(strcmp(optarg, "hugetlbfs") == 0) {
+          hugePageType = HUGE_PAGES_HUGETLBFS;
+        } else {
+          printf("Huge page type '%s' not supported.", optarg);
+          exit(-1);
+        }
+        break;
+      case OPTION_HUGETLBFS_PATH:
+        hugeTLBFSPath = string(optarg);
+        break;
+      case OPTION_TIMER:
+        if(strcmp(optarg, "rdtscp") == 0) {
+          timerType = TIMER_RDTSCP;
+        } else if(strcmp(optarg, "lfence-rdtsc") == 0) {
+          timerType = TIMER_LFENCE_RDTSC;
+        } else if(strcmp(optarg, "monotonic-raw") == 0) {
+          timerType = TIMER_MONOTONIC_RAW;
+        } else if(strcmp(optarg, "perf-cycles") == 0) {
+          timerType = TIMER_PERF_CYCLES;
+        } else {
+          printf("Timer '%s' not supported.", optarg);
+          exit(-1);
+        }
+        break;
+      case OPTION_CALIBRATE_TIMER:
+        calibrateTimer = true;
+        break;
+      case OPTION_THRESHOLD_ESTIMATOR:
+        if(strcmp(optarg, "histogram") == 0) {
+          thresholdEstimator = THRESHOLD_ESTIMATOR_HISTOGRAM;
+        } else if(strcmp(optarg, "minimum-error") == 0) {
+          thresholdEstimator = THRESHOLD_ESTIMATOR_MINIMUM_ERROR;
+        } else {
+          printf("Threshold estimator '%s' not supported.", optarg);
+          exit(-1);
+        }
+        break;
+      case OPTION_MONITOR_THRESHOLD:
+        monitorThreshold = true;
+        break;
+      case OPTION_CACHE_REPRESENTATIVES:
+        cacheRepresentatives = true;
+        break;
+      case OPTION_REGROUP_MARGIN:
+        regroupMargin = handleNumericalValue(optarg, long_options[option_index].name);
+        break;
+      case OPTION_CONSOLIDATE_GROUPS:
+        consolidateGroups = true;
+        break;
+      case OPTION_MAX_REGROUP_TRIES:
+        maxRegroupTries = handleNumericalValue(optarg, long_options[option_index].name);
+        break;
+      case OPTION_GROUPING:
+        if(strcmp(optarg, "greedy") == 0) {
+          grouping = GROUPING_GREEDY;
+        } else if(strcmp(optarg, "pivot") == 0) {
+          grouping = GROUPING_PIVOT;
+        } else {
+          printf("Grouping '%s' not supported.", optarg);
+          exit(-1);
+        }
+        break;
+      case OPTION_PIVOTS:
+        nPivots = handleNumericalValue(optarg, long_options[option_index].name);
+        break;
       case '?':
       default:
         printLogMessage(LOG_ERROR, "Invalid option '" + to_string(c) + "'.");
@@ -123,6 +333,20 @@ Config::Config(int argc, char *argv[]) {
     }
   }
 
+  // The first argument that is not an option is a dataset, all further ones
+  // are results of shards (when shards are merged).
+  if(optind < argc) {
+    datasetPath = argv[optind];
+    for(int i = optind + 1; i < argc; i++) {
+      shardResultPaths.push_back(argv[i]);
+    }
+  }
+  if((nShards > 0 || nLocalShards > 1 || mergeShards) && datasetPath == "") {
+    printLogMessage(LOG_ERROR, "Shards can only be used with a dataset.");
+    printf("\n");
+    printHelpPage(EXIT_FAILURE);
+  }
+
   setLogLevel(logLevel);
 }
 
@@ -224,12 +448,167 @@ uint64_t Config::getEndOffset() {
   return endOffset;
 }
 
+uint64_t Config::getMaskSolver() {
+  return maskSolver;
+}
+
+bool Config::isMaskBitPruningEnabled() {
+  return pruneMaskBits;
+}
+
+uint64_t Config::getNumberOfRelevantBitBases() {
+  return numberOfRelevantBitBases;
+}
+
+uint64_t Config::getMaskOrder() {
+  return maskOrder;
+}
+
+bool Config::isEarlySearchTerminationEnabled() {
+  return stopSearchEarly;
+}
+
+uint64_t Config::getSampleSize() {
+  return sampleSize;
+}
+
+uint64_t Config::getHoldoutPercentage() {
+  return holdoutPercentage;
+}
+
+uint64_t Config::getNumberOfBootstrapSamples() {
+  return nBootstrapSamples;
+}
+
+uint64_t Config::getNumberOfConvergenceTHPs() {
+  return nConvergenceTHPs;
+}
+
+bool Config::isDenoisingEnabled() {
+  return denoiseAddresses;
+}
+
+string Config::getDatasetSavePath() {
+  return datasetSavePath;
+}
+
+string Config::getDatasetPath() {
+  return datasetPath;
+}
+
+bool Config::isShardWorker() {
+  return nShards > 0;
+}
+
+uint64_t Config::getShardIndex() {
+  return shardIdx;
+}
+
+uint64_t Config::getNumberOfShards() {
+  return nShards;
+}
+
+uint64_t Config::getNumberOfLocalShards() {
+  return nLocalShards;
+}
+
+bool Config::isShardMergeEnabled() {
+  return mergeShards;
+}
+
+vector<string> *Config::getShardResultPaths() {
+  return &shardResultPaths;
+}
+
+bool Config::isInterleavedTimingEnabled() {
+  return interleaveTimings;
+}
+
+uint64_t Config::getSequentialTimingConfidence() {
+  return sequentialTimingConfidence;
+}
+
+uint64_t Config::getProbeMargin() {
+  return probeMargin;
+}
+
+bool Config::isProbeVerificationEnabled() {
+  return verifyProbes;
+}
+
+uint64_t Config::getNumberOfMeasurementWorkers() {
+  if(!measurementCores.empty()) {
+    return measurementCores.size();
+  }
+  return nMeasurementWorkers;
+}
+
+vector<uint64_t> *Config::getMeasurementCores() {
+  return &measurementCores;
+}
+
+uint64_t Config::getHugePageType() {
+  return hugePageType;
+}
+
+string Config::getHugeTLBFSPath() {
+  return hugeTLBFSPath;
+}
+
+uint64_t Config::getTimerType() {
+  return timerType;
+}
+
+void Config::setTimerType(uint64_t timerType) {
+  this->timerType = timerType;
+}
+
+bool Config::isTimerCalibrationEnabled() {
+  return calibrateTimer;
+}
+
+uint64_t Config::getThresholdEstimator() {
+  return thresholdEstimator;
+}
+
+bool Config::isThresholdMonitoringEnabled() {
+  return monitorThreshold;
+}
+
+bool Config::isRepresentativeCachingEnabled() {
+  return cacheRepresentatives;
+}
+
+uint64_t Config::getRegroupMargin() {
+  return regroupMargin;
+}
+
+bool Config::isGroupConsolidationEnabled() {
+  return consolidateGroups;
+}
+
+uint64_t Config::getMaximumNumberOfRegroupTries() {
+  return maxRegroupTries;
+}
+
+uint64_t Config::getGrouping() {
+  return grouping;
+}
+
+uint64_t Config::getNumberOfPivots() {
+  return nPivots;
+}
+
 void Config::printHelpPage(uint64_t exit_state) {
   printf("AMDRE(1)\n");
   printf("%sNAME%s\n", STYLE_BOLD, STYLE_RESET);
   printf("  amdre - AMD bank interleaving function reverse engineering tool\n\n");
   printf("%sSYNOPSIS%s\n", STYLE_BOLD, STYLE_RESET);
-  printf("  amdre [%sOPTION%s]...\n\n", STYLE_UNDERLINE, STYLE_RESET);
+  printf("  amdre [%sOPTION%s]...\n", STYLE_UNDERLINE, STYLE_RESET);
+  printf("  amdre [%sOPTION%s]... %sDATASET%s\n", STYLE_UNDERLINE, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("  amdre [%sOPTION%s]... %s--merge-shards%s %sDATASET%s %sSHARD%s...\n\n", STYLE_UNDERLINE, STYLE_RESET, STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("  When a DATASET saved with --save-dataset is given, the address functions are\n");
+  printf("  derived from its addresses without measuring (and without root).\n\n");
   printf("%sDESCRIPTION%s\n", STYLE_BOLD, STYLE_RESET);
   printf("  %s-h%s, %s--help%s\n", STYLE_BOLD, STYLE_RESET, STYLE_BOLD, STYLE_RESET);
   printf("    Show this help message and exit\n");
@@ -268,6 +647,130 @@ void Config::printHelpPage(uint64_t exit_state) {
   printf("  %s-x%s, %s--max-mask-bits%s=%sNUMBER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
   printf("    maximum NUMBER of bits that is set in mask candidates; therfore, only masks\n");
   printf("    with a maximum of NUMBER bits will be detected (default: 7)\n");
+  printf("  %s-M%s, %s--mask-solver%s=%sSOLVER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    SOLVER used to derive the address functions; can be set to 'brute-force'\n");
+  printf("    (enumerate all masks up to --max-mask-bits) and 'linear' (solve the\n");
+  printf("    grouped addresses as linear system over GF(2) without a limit for the\n");
+  printf("    number of bits per mask) (default: 'brute-force')\n");
+  printf("  %s--no-bit-pruning%s\n", STYLE_BOLD, STYLE_RESET);
+  printf("    Use all bits above the block size for mask candidates instead of only the\n");
+  printf("    bits that were identified as relevant (enabled by default)\n");
+  printf("  %s--relevant-bit-bases%s=%sNUMBER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    NUMBER of base addresses used to identify the bits that are relevant for\n");
+  printf("    the bank (default: 64)\n");
+  printf("  %s--mask-order%s=%sORDER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    ORDER in which mask candidates are enumerated; can be set to 'colex' and\n");
+  printf("    'revolving-door' (consecutive candidates differ in two bits, so the results\n");
+  printf("    are updated incrementally instead of evaluated from scratch)\n");
+  printf("    (default: 'colex')\n");
+  printf("  %s--exhaustive-search%s\n", STYLE_BOLD, STYLE_RESET);
+  printf("    Evaluate all mask candidates instead of stopping the search as soon as the\n");
+  printf("    valid masks found separate all banks (disabled by default)\n");
+  printf("  %s--sample-size%s=%sNUMBER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    NUMBER of addresses per group (plus twice the number of tolerated errors)\n");
+  printf("    that are checked before all addresses are checked; a mask is rejected when\n");
+  printf("    the sample already has too many errors (default: 32)\n");
+  printf("  %s--holdout-percentage%s=%sPERCENT%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    PERCENT of the addresses of each group that are not used to derive the\n");
+  printf("    address functions but to verify them afterwards (default: 0, the functions\n");
+  printf("    are verified on all addresses)\n");
+  printf("  %s--bootstrap-samples%s=%sNUMBER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    NUMBER of bootstrap samples for the confidence intervals of the agreement\n");
+  printf("    rates of the address functions (default: 1000)\n");
+  printf("  %s--convergence-thps%s=%sNUMBER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    Stop adding additional THPs when the linear system of the address functions\n");
+  printf("    did not change for NUMBER THPs (disabled by default)\n");
+  printf("  %s--denoise%s\n", STYLE_BOLD, STYLE_RESET);
+  printf("    Move or remove wrongly grouped addresses before the address functions are\n");
+  printf("    derived (disabled by default)\n");
+  printf("  %s--save-dataset%s=%sFILE%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    Save the grouped physical addresses to FILE before the address functions are\n");
+  printf("    derived\n");
+  printf("  %s--shards%s=%sNUMBER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    Split the mask search of a DATASET into NUMBER local worker processes and\n");
+  printf("    merge their results (default: 1)\n");
+  printf("  %s--solve-shard%s=%sINDEX%s/%sNUMBER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    Only search shard INDEX (starting at 0) of NUMBER shards of a DATASET and\n");
+  printf("    print the valid masks, one per line\n");
+  printf("  %s--merge-shards%s\n", STYLE_BOLD, STYLE_RESET);
+  printf("    Derive the address functions of a DATASET from the valid masks in the\n");
+  printf("    SHARD files written by --solve-shard\n");
+  printf("  %s--interleaved-timing%s\n", STYLE_BOLD, STYLE_RESET);
+  printf("    Measure an address against all groups at once in several rounds instead of\n");
+  printf("    one group after another, so timing noise does not hit a single group\n");
+  printf("    (disabled by default)\n");
+  printf("  %s--sequential-timing%s=%sPERCENT%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    Compare an address against a group in small steps and stop as soon as it is\n");
+  printf("    clear with a confidence of PERCENT whether the accesses conflict, at most\n");
+  printf("    the usual number of measurements is used (disabled by default)\n");
+  printf("  %s--probe-margin%s=%sCYCLES%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    Compare an address with the most likely groups first (based on the group\n");
+  printf("    of the previous block) and stop at the first group that is CYCLES above\n");
+  printf("    the row conflict threshold (disabled by default)\n");
+  printf("  %s--probe-verify%s\n", STYLE_BOLD, STYLE_RESET);
+  printf("    Also compare the address with the next group after a probe stopped, all\n");
+  printf("    groups are compared when it is above the threshold as well\n");
+  printf("  %s--measurement-workers%s=%sNUMBER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    NUMBER of threads that measure different addresses at the same time, each\n");
+  printf("    pinned to its own physical core; fewer workers are used when they disturb\n");
+  printf("    each other's measurements (default: 1)\n");
+  printf("  %s--measurement-cores%s=%sLIST%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    Comma separated LIST of cores for the measurement workers, one worker is\n");
+  printf("    started per core (default: one core per physical core and L3 cache)\n");
+  printf("  %s--huge-pages%s=%sTYPE%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    TYPE of the huge pages the THPs are taken from; can be set to 'thp'\n");
+  printf("    (transparent huge pages), 'hugetlb-2m', 'hugetlb-1g' (reserved huge pages,\n");
+  printf("    see /proc/sys/vm/nr_hugepages) and 'hugetlbfs' (files on a hugetlbfs mount);\n");
+  printf("    consecutive THPs are physically contiguous within one 1G page (default: 'thp')\n");
+  printf("  %s--hugetlbfs-path%s=%sDIRECTORY%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    DIRECTORY of the hugetlbfs mount used by --huge-pages=hugetlbfs\n");
+  printf("    (default: /dev/hugepages)\n");
+  printf("  %s--timer%s=%sTIMER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    TIMER used to measure access times; can be set to 'rdtscp', 'lfence-rdtsc',\n");
+  printf("    'monotonic-raw' (clock_gettime, nanoseconds) and 'perf-cycles' (core cycles\n");
+  printf("    from perf_event) (default: 'rdtscp')\n");
+  printf("  %s--calibrate-timer%s\n", STYLE_BOLD, STYLE_RESET);
+  printf("    Measure the overhead of the timer and of the measurement loop at startup\n");
+  printf("    and subtract it from all measured access times; a given\n");
+  printf("    --row-conflict-threshold is not adjusted and has to be on the calibrated\n");
+  printf("    scale\n");
+  printf("  %s--threshold-estimator%s=%sESTIMATOR%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    ESTIMATOR used to measure the threshold; can be set to 'histogram' (gap in\n");
+  printf("    the histogram of each of --measurements-for-threshold THPs) and\n");
+  printf("    'minimum-error' (split one histogram with minimum error thresholding,\n");
+  printf("    stops once the threshold is stable; --measurements-for-threshold is the\n");
+  printf("    maximum number of rounds; falls back to 'histogram' when the split does\n");
+  printf("    not separate two classes)\n");
+  printf("    (default: 'histogram')\n");
+  printf("  %s--monitor-threshold%s\n", STYLE_BOLD, STYLE_RESET);
+  printf("    Follow drifts of the threshold while addresses are grouped; the recent\n");
+  printf("    access times (also of --sequential-timing and --interleaved-timing) are\n");
+  printf("    split with minimum error thresholding in the background and the\n");
+  printf("    threshold is moved when the split moved by more than 5%%\n");
+  printf("  %s--cache-representatives%s\n", STYLE_BOLD, STYLE_RESET);
+  printf("    Compare new addresses with a fixed set of addresses of each address\n");
+  printf("    group that conflict with each other, instead of a new random set for\n");
+  printf("    every address; the set is chosen again when the group doubled in size\n");
+  printf("  %s--regroup-margin%s=%sCYCLES%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    When regrouping, only measure the addresses again whose group was less\n");
+  printf("    than CYCLES ahead of the next best group, and the addresses of groups\n");
+  printf("    that are much smaller than the others (default: all addresses are\n");
+  printf("    measured again)\n");
+  printf("  %s--consolidate-groups%s\n", STYLE_BOLD, STYLE_RESET);
+  printf("    Before regrouping, measure the address groups against each other, merge\n");
+  printf("    the groups that conflict and move the addresses of very small groups to\n");
+  printf("    the other groups\n");
+  printf("  %s--max-regroup-tries%s=%sNUMBER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    Maximum NUMBER of times the addresses are regrouped until the number of\n");
+  printf("    banks is a power of 2 (default: 100)\n");
+  printf("  %s--grouping%s=%sENGINE%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    ENGINE used to group the addresses of the initial THPs; can be set to\n");
+  printf("    'greedy' (compare every address with every group) and 'pivot' (compare\n");
+  printf("    every address with --pivots addresses and cluster the results)\n");
+  printf("    (default: 'greedy')\n");
+  printf("  %s--pivots%s=%sNUMBER%s\n", STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
+  printf("    NUMBER of pivot addresses for --grouping=pivot; should be a few times\n");
+  printf("    the number of banks (default: 128)\n");
   printf("  %s-g%s, %s--memory-type%s=%sTYPE%s\n", STYLE_BOLD, STYLE_RESET, STYLE_BOLD, STYLE_RESET, STYLE_UNDERLINE, STYLE_RESET);
   printf("    TYPE of the memory that is used; this specifies if clflush() or clflushopt()\n");
   printf("    is called; can be set to 'ddr3' and 'ddr4' (default: 'ddr4')\n");
@@ -6,6 +6,8 @@
 
 #include<cinttypes>
 #include<unistd.h>
+#include<string>
+#include<vector>
 
 using namespace std;
 
@@ -13,6 +15,61 @@ using namespace std;
 #define STYLE_BOLD "\e[1m"
 #define STYLE_UNDERLINE "\e[4m"
 
+#define MASK_SOLVER_BRUTE_FORCE 0
+#define MASK_SOLVER_LINEAR 1
+
+#define MASK_ORDER_COLEX 0
+#define MASK_ORDER_REVOLVING_DOOR 1
+
+#define HUGE_PAGES_THP 0
+#define HUGE_PAGES_HUGETLB_2M 1
+#define HUGE_PAGES_HUGETLB_1G 2
+#define HUGE_PAGES_HUGETLBFS 3
+
+#define TIMER_RDTSCP 0
+#define TIMER_LFENCE_RDTSC 1
+#define TIMER_MONOTONIC_RAW 2
+#define TIMER_PERF_CYCLES 3
+
+#define THRESHOLD_ESTIMATOR_HISTOGRAM 0
+#define THRESHOLD_ESTIMATOR_MINIMUM_ERROR 1
+
+#define GROUPING_GREEDY 0
+#define GROUPING_PIVOT 1
+
+// Values for options without a short option
+#define OPTION_NO_BIT_PRUNING 256
+#define OPTION_RELEVANT_BIT_BASES 257
+#define OPTION_MASK_ORDER 258
+#define OPTION_EXHAUSTIVE_SEARCH 259
+#define OPTION_SAMPLE_SIZE 260
+#define OPTION_HOLDOUT_PERCENTAGE 261
+#define OPTION_BOOTSTRAP_SAMPLES 262
+#define OPTION_CONVERGENCE_THPS 263
+#define OPTION_DENOISE 264
+#define OPTION_SAVE_DATASET 265
+#define OPTION_SOLVE_SHARD 266
+#define OPTION_SHARDS 267
+#define OPTION_MERGE_SHARDS 268
+#define OPTION_INTERLEAVED_TIMING 269
+#define OPTION_SEQUENTIAL_TIMING 270
+#define OPTION_PROBE_MARGIN 271
+#define OPTION_PROBE_VERIFY 272
+#define OPTION_MEASUREMENT_WORKERS 273
+#define OPTION_MEASUREMENT_CORES 274
+#define OPTION_HUGE_PAGES 275
+#define OPTION_HUGETLBFS_PATH 276
+#define OPTION_TIMER 277
+#define OPTION_CALIBRATE_TIMER 278
+#define OPTION_THRESHOLD_ESTIMATOR 279
+#define OPTION_MONITOR_THRESHOLD 280
+#define OPTION_CACHE_REPRESENTATIVES 281
+#define OPTION_REGROUP_MARGIN 282
+#define OPTION_CONSOLIDATE_GROUPS 283
+#define OPTION_MAX_REGROUP_TRIES 284
+#define OPTION_GROUPING 285
+#define OPTION_PIVOTS 286
+
 class Config {
   private:
 	  uint64_t nInitialTHPs = 1;
@@ -36,6 +93,41 @@ class Config {
     uint64_t nPagesPerTHP = 512;
     uint64_t startOffset = 0;
     uint64_t endOffset = 512;
+    uint64_t maskSolver = MASK_SOLVER_BRUTE_FORCE;
+    bool pruneMaskBits = true;
+    uint64_t numberOfRelevantBitBases = 64;
+    uint64_t maskOrder = MASK_ORDER_COLEX;
+    bool stopSearchEarly = true;
+    uint64_t sampleSize = 32;
+    uint64_t holdoutPercentage = 0;
+    uint64_t nBootstrapSamples = 1000;
+    uint64_t nConvergenceTHPs = 0;
+    bool denoiseAddresses = false;
+    string datasetSavePath = "";
+    string datasetPath = "";
+    uint64_t shardIdx = 0;
+    uint64_t nShards = 0;
+    uint64_t nLocalShards = 1;
+    bool mergeShards = false;
+    vector<string> shardResultPaths;
+    bool interleaveTimings = false;
+    uint64_t sequentialTimingConfidence = 0;
+    uint64_t probeMargin = 0;
+    bool verifyProbes = false;
+    uint64_t nMeasurementWorkers = 1;
+    vector<uint64_t> measurementCores;
+    uint64_t hugePageType = HUGE_PAGES_THP;
+    string hugeTLBFSPath = "/dev/hugepages";
+    uint64_t timerType = TIMER_RDTSCP;
+    bool calibrateTimer = false;
+    uint64_t thresholdEstimator = THRESHOLD_ESTIMATOR_HISTOGRAM;
+    bool monitorThreshold = false;
+    bool cacheRepresentatives = false;
+    uint64_t regroupMargin = 0;
+    bool consolidateGroups = false;
+    uint64_t maxRegroupTries = 100;
+    uint64_t grouping = GROUPING_GREEDY;
+    uint64_t nPivots = 128;
   public:
     Config(int argc, char *argv[]);
     ~Config();
@@ -60,6 +152,43 @@ class Config {
     void (*getClFlush())(volatile void *);
     uint64_t getStartOffset();
     uint64_t getEndOffset();
+    uint64_t getMaskSolver();
+    bool isMaskBitPruningEnabled();
+    uint64_t getNumberOfRelevantBitBases();
+    uint64_t getMaskOrder();
+    bool isEarlySearchTerminationEnabled();
+    uint64_t getSampleSize();
+    uint64_t getHoldoutPercentage();
+    uint64_t getNumberOfBootstrapSamples();
+    uint64_t getNumberOfConvergenceTHPs();
+    bool isDenoisingEnabled();
+    string getDatasetSavePath();
+    string getDatasetPath();
+    bool isShardWorker();
+    uint64_t getShardIndex();
+    uint64_t getNumberOfShards();
+    uint64_t getNumberOfLocalShards();
+    bool isShardMergeEnabled();
+    vector<string> *getShardResultPaths();
+    bool isInterleavedTimingEnabled();
+    uint64_t getSequentialTimingConfidence();
+    uint64_t getProbeMargin();
+    bool isProbeVerificationEnabled();
+    uint64_t getNumberOfMeasurementWorkers();
+    vector<uint64_t> *getMeasurementCores();
+    uint64_t getHugePageType();
+    string getHugeTLBFSPath();
+    uint64_t getTimerType();
+    void setTimerType(uint64_t timerType);
+    bool isTimerCalibrationEnabled();
+    uint64_t getThresholdEstimator();
+    bool isThresholdMonitoringEnabled();
+    bool isRepresentativeCachingEnabled();
+    uint64_t getRegroupMargin();
+    bool isGroupConsolidationEnabled();
+    uint64_t getMaximumNumberOfRegroupTries();
+    uint64_t getGrouping();
+    uint64_t getNumberOfPivots();
 };
 
 #endif
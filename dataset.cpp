@@ -0,0 +1,107 @@
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<cinttypes>
+#include<string>
+#include<vector>
+
+#include "dataset.h"
+#include "logger.h"
+
+using namespace std;
+
+#define DATASET_VERSION 1
+
+bool saveDataset(string path, vector<vector<uint64_t>*> *physicalAddresses, uint64_t blockSize, uint64_t nBanks) {
+  FILE *file = fopen(path.c_str(), "w");
+  if(file == NULL) {
+    printLogMessage(LOG_ERROR, "Could not open " + path + " to save the dataset.");
+    return false;
+  }
+
+  fprintf(file, "amdre-dataset %d\n", DATASET_VERSION);
+  fprintf(file, "block-size %" PRIu64 "\n", blockSize);
+  fprintf(file, "banks %" PRIu64 "\n", nBanks);
+  fprintf(file, "groups %zu\n", physicalAddresses->size());
+  for(vector<uint64_t> *group : *physicalAddresses) {
+    fprintf(file, "group %zu\n", group->size());
+    for(uint64_t physicalAddress : *group) {
+      fprintf(file, "0x%" PRIx64 "\n", physicalAddress);
+    }
+  }
+
+  bool success = !ferror(file);
+  if(fclose(file) != 0 || !success) {
+    printLogMessage(LOG_ERROR, "Could not write the dataset to " + path + ".");
+    return false;
+  }
+  return true;
+}
+
+vector<vector<uint64_t>*> *loadDataset(string path, uint64_t *blockSize, uint64_t *nBanks) {
+  FILE *file = fopen(path.c_str(), "r");
+  if(file == NULL) {
+    printLogMessage(LOG_ERROR, "Could not open dataset " + path + ".");
+    return NULL;
+  }
+
+  int version = 0;
+  uint64_t nGroups = 0;
+  if(fscanf(file, "amdre-dataset %d block-size %" SCNu64 " banks %" SCNu64 " groups %" SCNu64, &version, blockSize, nBanks, &nGroups) != 4 || version != DATASET_VERSION) {
+    printLogMessage(LOG_ERROR, "The header of dataset " + path + " is invalid.");
+    fclose(file);
+    return NULL;
+  }
+
+  vector<vector<uint64_t>*> *physicalAddresses = new vector<vector<uint64_t>*>();
+  bool valid = true;
+  for(uint64_t groupIdx = 0; groupIdx < nGroups && valid; groupIdx++) {
+    uint64_t groupSize = 0;
+    valid = fscanf(file, " group %" SCNu64, &groupSize) == 1;
+    vector<uint64_t> *group = new vector<uint64_t>();
+    for(uint64_t i = 0; i < groupSize && valid; i++) {
+      uint64_t physicalAddress = 0;
+      valid = fscanf(file, " 0x%" SCNx64, &physicalAddress) == 1;
+      group->push_back(physicalAddress);
+    }
+    physicalAddresses->push_back(group);
+  }
+  fclose(file);
+
+  if(!valid) {
+    printLogMessage(LOG_ERROR, "Dataset " + path + " is incomplete.");
+    for(vector<uint64_t> *group : *physicalAddresses) {
+      delete group;
+    }
+    delete physicalAddresses;
+    return NULL;
+  }
+  return physicalAddresses;
+}
+
+vector<uint64_t> *readMasks(FILE *file) {
+  // Masks are written one per line in hexadecimal. All other lines (e.g. log
+  // messages) are skipped.
+  vector<uint64_t> *masks = new vector<uint64_t>();
+  char *line = NULL;
+  size_t lineLength = 0;
+  while(getline(&line, &lineLength, file) != -1) {
+    uint64_t mask = 0;
+    if(sscanf(line, "0x%" SCNx64, &mask) == 1) {
+      masks->push_back(mask);
+    }
+  }
+  free(line);
+  return masks;
+}
+
+vector<uint64_t> *loadMasks(string path) {
+  FILE *file = fopen(path.c_str(), "r");
+  if(file == NULL) {
+    printLogMessage(LOG_ERROR, "Could not open " + path + ".");
+    return NULL;
+  }
+  vector<uint64_t> *masks = readMasks(file);
+  fclose(file);
+  return masks;
+}
@@ -0,0 +1,25 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include<cstdint>
+#include<cstdio>
+#include<string>
+#include<vector>
+
+using namespace std;
+
+/**
+ * A dataset contains the grouped physical addresses of a measurement together
+ * with the block size and the number of banks, so the address functions can
+ * be derived later (or on another machine) without measuring again.
+ *
+ * The file is plain text: a header with the block size, the number of banks
+ * and the number of groups, followed by every group (its size and one
+ * hexadecimal physical address per line).
+ */
+bool saveDataset(string path, vector<vector<uint64_t>*> *physicalAddresses, uint64_t blockSize, uint64_t nBanks);
+vector<vector<uint64_t>*> *loadDataset(string path, uint64_t *blockSize, uint64_t *nBanks);
+vector<uint64_t> *readMasks(FILE *file);
+vector<uint64_t> *loadMasks(string path);
+
+#endif
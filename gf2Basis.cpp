@@ -0,0 +1,109 @@
+#include<cstdint>
+#include<vector>
+
+#include "gf2Basis.h"
+
+using namespace std;
+
+GF2Basis::GF2Basis() {
+  for(uint64_t i = 0; i < 64; i++) {
+    rows[i] = 0;
+  }
+  rank = 0;
+}
+
+GF2Basis::~GF2Basis() {
+
+}
+
+bool GF2Basis::addVector(uint64_t vector) {
+  vector = reduce(vector);
+  if(vector == 0) {
+    // The vector is a combination of the vectors already stored in the basis
+    return false;
+  }
+
+  rows[63 - __builtin_clzl(vector)] = vector;
+  rank++;
+  return true;
+}
+
+uint64_t GF2Basis::reduce(uint64_t vector) {
+  // Every row clears its own leading bit and only touches lower bits, so the
+  // vector is processed from the most significant bit downwards.
+  uint64_t remaining = vector;
+  while(remaining != 0) {
+    uint64_t bit = 63 - __builtin_clzl(remaining);
+    if(rows[bit] != 0) {
+      vector ^= rows[bit];
+    }
+    remaining = vector & ((1UL<<bit) - 1);
+  }
+  return vector;
+}
+
+bool GF2Basis::isInSpan(uint64_t vector) {
+  return reduce(vector) == 0;
+}
+
+uint64_t GF2Basis::getRank() {
+  return rank;
+}
+
+uint64_t GF2Basis::getPivots() {
+  uint64_t pivots = 0;
+  for(uint64_t i = 0; i < 64; i++) {
+    if(rows[i] != 0) {
+      pivots |= (1UL<<i);
+    }
+  }
+  return pivots;
+}
+
+vector<uint64_t> *GF2Basis::getBasis() {
+  vector<uint64_t> *basis = new vector<uint64_t>();
+  for(uint64_t i = 0; i < 64; i++) {
+    if(rows[i] != 0) {
+      basis->push_back(rows[i]);
+    }
+  }
+  return basis;
+}
+
+vector<uint64_t> *GF2Basis::getNullspace(uint64_t columns) {
+  // Bring the rows to reduced row echelon form, so every pivot bit is only set
+  // in the row it belongs to. All rows are expected to be within columns.
+  uint64_t reduced[64];
+  for(uint64_t i = 0; i < 64; i++) {
+    reduced[i] = rows[i];
+  }
+  for(uint64_t pivot = 0; pivot < 64; pivot++) {
+    if(reduced[pivot] == 0) {
+      continue;
+    }
+    for(uint64_t i = pivot + 1; i < 64; i++) {
+      if(reduced[i]>>pivot&1) {
+        reduced[i] ^= reduced[pivot];
+      }
+    }
+  }
+
+  // Every free column (a column without a pivot) yields one vector of the
+  // nullspace: the free bit itself plus the pivot bits of all rows that
+  // contain the free bit. The scalar product with every row is then zero.
+  vector<uint64_t> *nullspace = new vector<uint64_t>();
+  uint64_t freeColumns = columns & ~getPivots();
+  for(uint64_t column = 0; column < 64; column++) {
+    if(!(freeColumns>>column&1)) {
+      continue;
+    }
+    uint64_t nullVector = 1UL<<column;
+    for(uint64_t pivot = 0; pivot < 64; pivot++) {
+      if(reduced[pivot]>>column&1) {
+        nullVector |= (1UL<<pivot);
+      }
+    }
+    nullspace->push_back(nullVector);
+  }
+  return nullspace;
+}
@@ -0,0 +1,30 @@
+#ifndef GF2_BASIS_H
+#define GF2_BASIS_H
+
+#include<cstdint>
+#include<vector>
+
+using namespace std;
+
+/**
+ * GF2Basis stores a set of 64 bit vectors over GF(2) in row echelon form. Each
+ * row is stored at the index of its most significant bit, so a vector can be
+ * reduced against the basis with at most one XOR per bit.
+ */
+class GF2Basis {
+  private:
+    uint64_t rows[64];
+    uint64_t rank;
+  public:
+    GF2Basis();
+    ~GF2Basis();
+    bool addVector(uint64_t vector);
+    uint64_t reduce(uint64_t vector);
+    bool isInSpan(uint64_t vector);
+    uint64_t getRank();
+    uint64_t getPivots();
+    vector<uint64_t> *getBasis();
+    vector<uint64_t> *getNullspace(uint64_t columns);
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include<algorithm>
 #include<iomanip>
 #include<mutex>
+#include<atomic>
 
 #include<errno.h>
 #include<fcntl.h>
@@ -14,9 +15,31 @@
 #include "helper.h"
 #include "config.h"
 #include "asm.h"
+#include "hugePageAllocator.h"
+#include "pagemapTranslator.h"
+#include "timer.h"
+#include "thresholdEstimator.h"
 
 using namespace std;
 Config *config = NULL;
+HugePageAllocator *hugePageAllocator = NULL;
+PagemapTranslator *pagemapTranslator = NULL;
+uint64_t (*readTimer)() = readTimerRdtscp;
+// Calibrated overhead of a pair of timer reads and of one iteration of the
+// measurement loop (with and without fences)
+uint64_t timerOverhead = 0;
+uint64_t loopOverhead = 0;
+uint64_t fencedLoopOverhead = 0;
+
+// Seed of the random number generator of the first thread
+#define RANDOM_SEED 0x616d647265
+
+// Number of runs the overheads are the median of
+#define TIMER_CALIBRATION_RUNS 1001
+// Minimum separation (d') of row hits and row conflicts for a threshold of the
+// minimum error estimator
+#define THRESHOLD_MIN_SEPARATION 4.5
+
 void (*clflush) (volatile void *);
 
 
@@ -52,13 +75,15 @@ uint64_t readFileAtOffset(const char filePath[], uint64_t offset) {
 }
 
 void *getPhysicalAddressForVirtualAddress(void *page) {
-  // Implement the resolution of the mapping here and return the PFN
-  uint64_t offset = ((uint64_t)(page) / sysconf(_SC_PAGESIZE)) * sizeof(uint64_t);
-  uint64_t pagemap = readFileAtOffset("/proc/self/pagemap", offset);
-  uint64_t pfn = pagemap & ((1L<<54) - 1);
-  uint64_t physicalBaseAddress = pfn * sysconf(_SC_PAGESIZE);
-  uint64_t physicalAddress = physicalBaseAddress | ((uint64_t)page & ((sysconf(_SC_PAGESIZE))-1));
-  return (void *)(physicalAddress);
+  return (void *)(pagemapTranslator->translate(page));
+}
+
+vector<uint64_t> *getPhysicalAddressesForVirtualAddresses(vector<void *> *addresses) {
+  return pagemapTranslator->translate(addresses);
+}
+
+void invalidatePhysicalAddresses(void *mapping, uint64_t size) {
+  pagemapTranslator->invalidate(mapping, size);
 }
 
 uint64_t measureAccessTime(void *a1, void *a2, uint64_t nMeasurements, bool fenced) {
@@ -67,7 +92,7 @@ uint64_t measureAccessTime(void *a1, void *a2, uint64_t nMeasurements, bool fenc
     mFenceFunc = real_mfence;
   }
 
-	uint64_t start = rdtscp();
+	uint64_t start = readTimer();
 
 	for(uint64_t i = 0; i < nMeasurements; i++) {
 		*(volatile char *)a1;
@@ -77,29 +102,62 @@ uint64_t measureAccessTime(void *a1, void *a2, uint64_t nMeasurements, bool fenc
     mFenceFunc();
 	}
 
-	return (rdtscp() - start) / nMeasurements;
+  uint64_t elapsed = readTimer() - start;
+  elapsed = elapsed > timerOverhead ? elapsed - timerOverhead : 0;
+  uint64_t time = elapsed / nMeasurements;
+  uint64_t overhead = fenced ? fencedLoopOverhead : loopOverhead;
+	return time > overhead ? time - overhead : 0;
 }
 
-void *getTHP() {
-	void *mapping = NULL;
-	if(posix_memalign(&mapping, config->getPagesPerTHP() * sysconf(_SC_PAGESIZE), config->getPagesPerTHP() * sysconf(_SC_PAGESIZE)) != 0) {
-		printf("Unable to map memory. Error: %s\n", strerror(errno));
-		return NULL;
-	}
+static uint64_t measureLoopOverhead(uint64_t nMeasurements, bool fenced) {
+  // Same loop as measureAccessTime, but both addresses stay cached
+  void(*mFenceFunc)() = fenced ? real_mfence : dummy_mfence;
+  volatile char cached[2] = {0, 0};
+  vector<uint64_t> times;
+  for(uint64_t run = 0; run < TIMER_CALIBRATION_RUNS; run++) {
+    uint64_t start = readTimer();
+    for(uint64_t i = 0; i < nMeasurements; i++) {
+      cached[0];
+      cached[1];
+      mFenceFunc();
+    }
+    uint64_t elapsed = readTimer() - start;
+    elapsed = elapsed > timerOverhead ? elapsed - timerOverhead : 0;
+    times.push_back(elapsed / nMeasurements);
+  }
+  nth_element(times.begin(), times.begin() + times.size()/2, times.end());
+  return times[times.size()/2];
+}
 
-	if(madvise(mapping, config->getPagesPerTHP() * sysconf(_SC_PAGESIZE), MADV_HUGEPAGE) != 0) {
-		printf("Unable to madvise. Error: %s\n", strerror(errno));
-		return NULL;
-	}
+void calibrateTimer() {
+  timerOverhead = 0;
+  loopOverhead = 0;
+  fencedLoopOverhead = 0;
+  vector<uint64_t> times;
+  for(uint64_t run = 0; run < TIMER_CALIBRATION_RUNS; run++) {
+    uint64_t start = readTimer();
+    times.push_back(readTimer() - start);
+  }
+  nth_element(times.begin(), times.begin() + times.size()/2, times.end());
+  timerOverhead = times[times.size()/2];
+  loopOverhead = measureLoopOverhead(config->getNumberOfMeasurementsPerGroupAddressComparisons(), false);
+  fencedLoopOverhead = measureLoopOverhead(config->getNumberOfMeasurementsPerGroupAddressComparisons(), true);
+  printLogMessage(LOG_INFO, "Timer overhead: " + to_string(timerOverhead) + ", loop overhead: " + to_string(loopOverhead) + " (" + to_string(fencedLoopOverhead) + " with fences).");
+}
 
-	for(uint64_t i = 0; i < config->getPagesPerTHP(); i++) {
-		*(volatile char *)((volatile char *)mapping + i * sysconf(_SC_PAGESIZE)) = 0x2a;
-	}
-  return mapping;
+void *getTHP() {
+  // The THP is taken from the configured huge page backend, which prefaults it
+  // and checks that it is physically contiguous.
+  void *thp = hugePageAllocator->allocate(config->getPagesPerTHP() * sysconf(_SC_PAGESIZE));
+  if(thp == NULL) {
+    printLogMessage(LOG_CRITICAL, "Unable to allocate a THP from " + hugePageAllocator->getName() + ".");
+    exit(EXIT_FAILURE);
+  }
+  return thp;
 }
 
 void freeTHP(void *thp) {
-	free(thp);
+  hugePageAllocator->release(thp);
 }
 
 int64_t measureSingleThreshold(bool fenced, bool debug) {
@@ -141,11 +199,24 @@ int64_t measureSingleThreshold(bool fenced, bool debug) {
     }
   }
 
-	free(mapping);
+	freeTHP(mapping);
   return retVal;
 }
 
 int measureThreshold() {
+  if(config->getThresholdEstimator() == THRESHOLD_ESTIMATOR_MINIMUM_ERROR) {
+    ThresholdEstimator thresholdEstimator(config);
+    uint64_t threshold = thresholdEstimator.estimate();
+    // Without row conflicts (or with a lot of noise), the split only cuts off
+    // a tail of the row hits
+    if(thresholdEstimator.getSeparation() >= THRESHOLD_MIN_SEPARATION) {
+      config->setRowConflictThreshold(threshold);
+      printLogMessage(LOG_DEBUG, "The threshold was stable after " + to_string(thresholdEstimator.getNumberOfRounds()) + " rounds.");
+      return EXIT_SUCCESS;
+    }
+    printLogMessage(LOG_WARNING, "The threshold split is not clear (separation " + to_string(thresholdEstimator.getSeparation()) + "), using the histogram estimator.");
+  }
+
 	uint64_t *thresholds = (uint64_t *)malloc(sizeof(uint64_t) * config->getNumberOfMeasurementsForThreshold());
 	for(uint64_t i = 0; i < config->getNumberOfMeasurementsForThreshold(); i++) {
 		thresholds[i] = measureSingleThreshold(config->areMemoryFencesEnabled());
@@ -159,25 +230,77 @@ int measureThreshold() {
 	return EXIT_SUCCESS;
 }
 
-vector<uint64_t> *getRandomIndices(uint64_t len, uint64_t nIndices) {
-  vector<uint64_t> *randomIndices = new vector<uint64_t>();
-  vector<uint64_t> allIndices;
-  for(uint64_t i = 0; i < len; i++) {
-    allIndices.push_back(i);
+static uint64_t splitMix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+uint64_t getRandomNumber() {
+  // xoshiro256** with one state per thread. The states are seeded in the
+  // order the threads draw their first number, so runs are reproducible.
+  static atomic<uint64_t> nSeededThreads(0);
+  static thread_local uint64_t state[4] = {0, 0, 0, 0};
+  static thread_local bool seeded = false;
+  if(!seeded) {
+    uint64_t seed = RANDOM_SEED + nSeededThreads++;
+    for(uint64_t i = 0; i < 4; i++) {
+      state[i] = splitMix64(&seed);
+    }
+    seeded = true;
   }
 
-  random_shuffle(allIndices.begin(), allIndices.end());
+  uint64_t result = rotateLeft(state[1] * 5, 7) * 9;
+  uint64_t t = state[1] << 17;
+  state[2] ^= state[0];
+  state[3] ^= state[1];
+  state[1] ^= state[2];
+  state[0] ^= state[3];
+  state[2] ^= t;
+  state[3] = rotateLeft(state[3], 45);
+  return result;
+}
 
-  for(uint64_t i = 0; i < nIndices && i < len; i++) {
-    randomIndices->push_back(allIndices[i]);
-  }
+uint64_t getRandomNumber(uint64_t bound) {
+  // Multiply-shift instead of modulo (Lemire)
+  return (uint64_t)(((unsigned __int128)getRandomNumber() * bound) >> 64);
+}
 
-  return randomIndices;
+uint64_t getRandomIndices(uint64_t len, uint64_t nIndices, uint64_t *indices) {
+  // Floyd's algorithm draws nIndices distinct indices with nIndices random
+  // numbers. The (few) indices are shuffled afterwards, since Floyd's
+  // algorithm does not return them in a random order.
+  uint64_t nDrawn = 0;
+  for(uint64_t j = len - min(nIndices, len); j < len; j++) {
+    uint64_t index = getRandomNumber(j + 1);
+    for(uint64_t i = 0; i < nDrawn; i++) {
+      if(indices[i] == index) {
+        index = j;
+        break;
+      }
+    }
+    indices[nDrawn++] = index;
+  }
+  for(uint64_t i = nDrawn; i > 1; i--) {
+    swap(indices[i - 1], indices[getRandomNumber(i)]);
+  }
+  return nDrawn;
 }
 
 void setConfigForHelper(Config *c) {
   config = c;
   clflush = config->getClFlush();
+  if(config->getTimerType() == TIMER_PERF_CYCLES && !isPerfCyclesTimerAvailable()) {
+    printLogMessage(LOG_WARNING, "perf_event cycles are not available, using rdtscp instead.");
+    config->setTimerType(TIMER_RDTSCP);
+  }
+  readTimer = getTimer(config->getTimerType());
+  delete hugePageAllocator;
+  hugePageAllocator = HugePageAllocator::create(config);
+  // The PFNs are read and cached per huge page
+  delete pagemapTranslator;
+  pagemapTranslator = new PagemapTranslator(hugePageAllocator->getHugePageSize());
 }
 
 bool isNumberPowerOfTwo(uint64_t number) {
@@ -13,12 +13,17 @@ using namespace std;
 int compareUInt64(const void *a1, const void *a2);
 uint64_t readFileAtOffset(char *filePath, uint64_t offset);
 void *getPhysicalAddressForVirtualAddress(void *page);
+vector<uint64_t> *getPhysicalAddressesForVirtualAddresses(vector<void *> *addresses);
+void invalidatePhysicalAddresses(void *mapping, uint64_t size);
 uint64_t measureAccessTime(void *a1, void *a2, uint64_t nMeasurements, bool fenced);
+void calibrateTimer();
 void *getTHP();
 void freeTHP(void *thp);
 int measureThreshold();
 int64_t measureSingleThreshold(bool fenced = true, bool debug = false);
-vector<uint64_t> *getRandomIndices(uint64_t len, uint64_t nIndices);
+uint64_t getRandomNumber();
+uint64_t getRandomNumber(uint64_t bound);
+uint64_t getRandomIndices(uint64_t len, uint64_t nIndices, uint64_t *indices);
 void setConfigForHelper(Config *c);
 bool isNumberPowerOfTwo(uint64_t number);
 
@@ -42,6 +47,10 @@ static inline uint64_t xorBits(long x) {
     return sum;
 }
 
+static inline uint64_t rotateLeft(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
 static inline int countBits(long x) {
     int sum = 0;
     while(x != 0) {
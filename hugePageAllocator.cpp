@@ -0,0 +1,252 @@
+#include<cstdio>
+#include<cstdint>
+#include<cstdlib>
+#include<string>
+#include<map>
+
+#include<errno.h>
+#include<fcntl.h>
+#include<string.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/vfs.h>
+
+#include "hugePageAllocator.h"
+#include "helper.h"
+
+using namespace std;
+
+// Number of times a huge page is mapped again when it is not physically
+// contiguous (only THPs can be split)
+#define HUGE_PAGE_ALLOCATION_RETRIES 3
+// Size of a transparent huge page when the kernel does not report it
+#define DEFAULT_THP_SIZE (2UL<<20)
+// File system type of hugetlbfs (statfs)
+#define HUGETLBFS_MAGIC 0x958458f6
+
+HugePageAllocator::HugePageAllocator(uint64_t hugePageSize) {
+  this->hugePageSize = hugePageSize;
+  this->mappings = new map<uint64_t, HugePageMapping>();
+  this->currentMapping = 0;
+  this->nextOffset = 0;
+  this->contiguityUnknown = false;
+}
+
+HugePageAllocator::~HugePageAllocator() {
+  delete mappings;
+}
+
+uint64_t HugePageAllocator::getHugePageSize() {
+  return hugePageSize;
+}
+
+bool HugePageAllocator::isPhysicallyContiguous(void *mapping, uint64_t size) {
+  // Every huge page has to consist of consecutive physical pages. Without the
+  // permission to read PFNs (not root), this can not be checked.
+  uint64_t pageSize = sysconf(_SC_PAGESIZE);
+  for(uint64_t hugePage = 0; hugePage < size; hugePage += hugePageSize) {
+    uint64_t base = (uint64_t)getPhysicalAddressForVirtualAddress((char *)mapping + hugePage);
+    if(base < pageSize) {
+      if(!contiguityUnknown) {
+        printLogMessage(LOG_WARNING, "Physical addresses are not available, huge pages are not checked for contiguity.");
+        contiguityUnknown = true;
+      }
+      return true;
+    }
+    for(uint64_t offset = pageSize; offset < hugePageSize && hugePage + offset < size; offset += pageSize) {
+      if((uint64_t)getPhysicalAddressForVirtualAddress((char *)mapping + hugePage + offset) != base + offset) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void *HugePageAllocator::mapVerifiedHugePages(uint64_t size) {
+  for(uint64_t i = 0; i <= HUGE_PAGE_ALLOCATION_RETRIES; i++) {
+    void *mapping = mapHugePages(size);
+    if(mapping != NULL) {
+      // The virtual addresses might have belonged to other physical pages
+      // before
+      invalidatePhysicalAddresses(mapping, size);
+    }
+    if(mapping == NULL || isPhysicallyContiguous(mapping, size)) {
+      return mapping;
+    }
+    if(i == HUGE_PAGE_ALLOCATION_RETRIES) {
+      printLogMessage(LOG_WARNING, "Unable to get physically contiguous " + getName() + " pages, using the last mapping anyway.");
+      return mapping;
+    }
+    unmapHugePages(mapping, size);
+  }
+  return NULL;
+}
+
+void *HugePageAllocator::allocate(uint64_t size) {
+  // Requests that are not smaller than a huge page get their own mapping
+  if(size >= hugePageSize || hugePageSize % size != 0) {
+    uint64_t mappingSize = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+    void *mapping = mapVerifiedHugePages(mappingSize);
+    if(mapping != NULL) {
+      (*mappings)[(uint64_t)mapping] = {mappingSize, 1, true};
+    }
+    return mapping;
+  }
+
+  if(currentMapping == 0 || nextOffset + size > hugePageSize) {
+    if(currentMapping != 0) {
+      (*mappings)[currentMapping].exhausted = true;
+      if((*mappings)[currentMapping].nChunks == 0) {
+        unmapHugePages((void *)currentMapping, hugePageSize);
+        mappings->erase(currentMapping);
+      }
+    }
+    currentMapping = (uint64_t)mapVerifiedHugePages(hugePageSize);
+    nextOffset = 0;
+    if(currentMapping == 0) {
+      return NULL;
+    }
+    (*mappings)[currentMapping] = {hugePageSize, 0, false};
+  }
+  void *chunk = (void *)(currentMapping + nextOffset);
+  nextOffset += size;
+  (*mappings)[currentMapping].nChunks++;
+  return chunk;
+}
+
+void HugePageAllocator::release(void *chunk) {
+  auto mapping = mappings->upper_bound((uint64_t)chunk);
+  if(mapping == mappings->begin()) {
+    return;
+  }
+  mapping--;
+  if((uint64_t)chunk >= mapping->first + mapping->second.size) {
+    return;
+  }
+  mapping->second.nChunks--;
+  if(mapping->second.nChunks == 0 && mapping->second.exhausted) {
+    unmapHugePages((void *)mapping->first, mapping->second.size);
+    mappings->erase(mapping);
+  }
+}
+
+HugePageAllocator *HugePageAllocator::create(Config *config) {
+  switch(config->getHugePageType()) {
+    case HUGE_PAGES_HUGETLB_2M:
+      return new HugeTLBAllocator(2UL<<20);
+    case HUGE_PAGES_HUGETLB_1G:
+      return new HugeTLBAllocator(1UL<<30);
+    case HUGE_PAGES_HUGETLBFS:
+      return new HugeTLBFSAllocator(config->getHugeTLBFSPath(), HugeTLBFSAllocator::getMountPageSize(config->getHugeTLBFSPath()));
+    default:
+      return new THPAllocator();
+  }
+}
+
+THPAllocator::THPAllocator() : HugePageAllocator(DEFAULT_THP_SIZE) {
+  FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+  if(file != NULL) {
+    unsigned long size = 0;
+    if(fscanf(file, "%lu", &size) == 1 && size > 0) {
+      hugePageSize = size;
+    }
+    fclose(file);
+  }
+}
+
+string THPAllocator::getName() {
+  return "THP";
+}
+
+void *THPAllocator::mapHugePages(uint64_t size) {
+  void *mapping = NULL;
+  if(posix_memalign(&mapping, hugePageSize, size) != 0) {
+    printf("Unable to map memory. Error: %s\n", strerror(errno));
+    return NULL;
+  }
+
+  if(madvise(mapping, size, MADV_HUGEPAGE) != 0) {
+    printf("Unable to madvise. Error: %s\n", strerror(errno));
+    free(mapping);
+    return NULL;
+  }
+
+  // Prefault all pages at once (Linux 5.14+), otherwise touch every page
+#ifdef MADV_POPULATE_WRITE
+  if(madvise(mapping, size, MADV_POPULATE_WRITE) == 0) {
+    return mapping;
+  }
+#endif
+  for(uint64_t offset = 0; offset < size; offset += sysconf(_SC_PAGESIZE)) {
+    *((volatile char *)mapping + offset) = 0x2a;
+  }
+  return mapping;
+}
+
+void THPAllocator::unmapHugePages(void *mapping, uint64_t size) {
+  free(mapping);
+}
+
+HugeTLBAllocator::HugeTLBAllocator(uint64_t hugePageSize) : HugePageAllocator(hugePageSize) {
+}
+
+string HugeTLBAllocator::getName() {
+  return "MAP_HUGETLB (" + to_string(hugePageSize >> 20) + "M)";
+}
+
+void *HugeTLBAllocator::mapHugePages(uint64_t size) {
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE | (__builtin_ctzl(hugePageSize) << MAP_HUGE_SHIFT);
+  void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if(mapping == MAP_FAILED) {
+    printf("Unable to map %ldM huge pages (see /proc/sys/vm/nr_hugepages). Error: %s\n", hugePageSize >> 20, strerror(errno));
+    return NULL;
+  }
+  return mapping;
+}
+
+void HugeTLBAllocator::unmapHugePages(void *mapping, uint64_t size) {
+  munmap(mapping, size);
+}
+
+HugeTLBFSAllocator::HugeTLBFSAllocator(string directory, uint64_t hugePageSize) : HugePageAllocator(hugePageSize) {
+  this->directory = directory;
+}
+
+string HugeTLBFSAllocator::getName() {
+  return "hugetlbfs (" + directory + ")";
+}
+
+uint64_t HugeTLBFSAllocator::getMountPageSize(string directory) {
+  // The block size of a hugetlbfs mount is its huge page size
+  struct statfs fileSystem;
+  if(statfs(directory.c_str(), &fileSystem) != 0) {
+    printf("Unable to access hugetlbfs mount '%s'. Error: %s\n", directory.c_str(), strerror(errno));
+    return DEFAULT_THP_SIZE;
+  }
+  if(fileSystem.f_type != HUGETLBFS_MAGIC) {
+    printLogMessage(LOG_WARNING, "'" + directory + "' is not a hugetlbfs mount, its memory is not backed by huge pages.");
+  }
+  return fileSystem.f_bsize;
+}
+
+void *HugeTLBFSAllocator::mapHugePages(uint64_t size) {
+  // The file is removed right away, the mapping keeps the huge pages
+  string path = directory + "/amdre-XXXXXX";
+  int fd = mkstemp(&path[0]);
+  if(fd == -1) {
+    printf("Unable to create a file in '%s'. Error: %s\n", directory.c_str(), strerror(errno));
+    return NULL;
+  }
+  unlink(path.c_str());
+  void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED) {
+    printf("Unable to map huge pages of '%s'. Error: %s\n", directory.c_str(), strerror(errno));
+    return NULL;
+  }
+  return mapping;
+}
+
+void HugeTLBFSAllocator::unmapHugePages(void *mapping, uint64_t size) {
+  munmap(mapping, size);
+}
@@ -0,0 +1,81 @@
+#ifndef HUGE_PAGE_ALLOCATOR_H
+#define HUGE_PAGE_ALLOCATOR_H
+
+#include<cstdint>
+#include<string>
+#include<map>
+
+#include "config.h"
+
+using namespace std;
+
+struct HugePageMapping {
+  uint64_t size;
+  uint64_t nChunks;
+  bool exhausted;
+};
+
+/**
+ * HugePageAllocator hands out physically contiguous memory. The backends map
+ * prefaulted huge pages: transparent huge pages (THP), MAP_HUGETLB with 2M or
+ * 1G pages or files on a hugetlbfs mount.
+ *
+ * Requests smaller than a huge page are cut out of the same huge page one
+ * after another, so the chunks of a 1G page are physically contiguous as well.
+ * A huge page is unmapped once all of its chunks were released. After a huge
+ * page was mapped, the pagemap is used to check that it is physically
+ * contiguous (THPs are not guaranteed).
+ */
+class HugePageAllocator {
+  private:
+    map<uint64_t, HugePageMapping> *mappings;
+    uint64_t currentMapping;
+    uint64_t nextOffset;
+    bool contiguityUnknown;
+    void *mapVerifiedHugePages(uint64_t size);
+    bool isPhysicallyContiguous(void *mapping, uint64_t size);
+  protected:
+    uint64_t hugePageSize;
+    virtual void *mapHugePages(uint64_t size) = 0;
+    virtual void unmapHugePages(void *mapping, uint64_t size) = 0;
+  public:
+    HugePageAllocator(uint64_t hugePageSize);
+    virtual ~HugePageAllocator();
+    virtual string getName() = 0;
+    uint64_t getHugePageSize();
+    void *allocate(uint64_t size);
+    void release(void *chunk);
+    static HugePageAllocator *create(Config *config);
+};
+
+class THPAllocator : public HugePageAllocator {
+  protected:
+    void *mapHugePages(uint64_t size);
+    void unmapHugePages(void *mapping, uint64_t size);
+  public:
+    THPAllocator();
+    string getName();
+};
+
+class HugeTLBAllocator : public HugePageAllocator {
+  protected:
+    void *mapHugePages(uint64_t size);
+    void unmapHugePages(void *mapping, uint64_t size);
+  public:
+    HugeTLBAllocator(uint64_t hugePageSize);
+    string getName();
+};
+
+class HugeTLBFSAllocator : public HugePageAllocator {
+  private:
+    string directory;
+  protected:
+    void *mapHugePages(uint64_t size);
+    void unmapHugePages(void *mapping, uint64_t size);
+  public:
+    HugeTLBFSAllocator(string directory, uint64_t hugePageSize);
+    string getName();
+    static uint64_t getMountPageSize(string directory);
+};
+
+#endif
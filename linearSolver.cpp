@@ -0,0 +1,228 @@
+#include<cstdint>
+#include<vector>
+#include<algorithm>
+
+#include "linearSolver.h"
+#include "helper.h"
+#include "logger.h"
+
+using namespace std;
+
+// Limits for the enumeration of the solution space. Above these dimensions,
+// the solution space is not enumerated completely anymore.
+#define MAX_FUNCTION_SPACE_DIMENSION 20
+#define MAX_CONSTANT_SPACE_DIMENSION 8
+
+LinearSolver::LinearSolver(uint64_t columns) {
+  this->columns = columns;
+  this->varyingBits = 0;
+  this->globalAnchor = 0;
+  this->hasGlobalAnchor = false;
+  this->anchors = new vector<uint64_t>();
+  this->hasAnchor = new vector<bool>();
+  this->groupConstraints = new GF2Basis();
+  this->globalConstraints = new GF2Basis();
+}
+
+LinearSolver::~LinearSolver() {
+  delete anchors;
+  delete hasAnchor;
+  delete groupConstraints;
+  delete globalConstraints;
+}
+
+bool LinearSolver::addAddress(uint64_t groupIdx, uint64_t physicalAddress) {
+  physicalAddress &= columns;
+  bool changed = false;
+
+  if(groupIdx >= anchors->size()) {
+    anchors->resize(groupIdx + 1, 0);
+    hasAnchor->resize(groupIdx + 1, false);
+  }
+
+  // The first address of each group is used as anchor. Every other address of
+  // the group has to produce the same result for every bank function, so the
+  // difference to the anchor is a constraint for all functions.
+  if(!(*hasAnchor)[groupIdx]) {
+    (*anchors)[groupIdx] = physicalAddress;
+    (*hasAnchor)[groupIdx] = true;
+  } else {
+    changed = groupConstraints->addVector(physicalAddress ^ (*anchors)[groupIdx]) || changed;
+  }
+
+  // Differences between arbitrary addresses describe which bit combinations
+  // are constant for all addresses. These combinations have no influence on
+  // the bank and are used to identify equivalent functions.
+  if(!hasGlobalAnchor) {
+    globalAnchor = physicalAddress;
+    hasGlobalAnchor = true;
+  } else {
+    varyingBits |= physicalAddress ^ globalAnchor;
+    changed = globalConstraints->addVector(physicalAddress ^ globalAnchor) || changed;
+  }
+  return changed;
+}
+
+bool LinearSolver::addGroups(vector<vector<uint64_t>*> *physicalAddresses) {
+  // Returns whether the system changed, e.g. whether any address added a new
+  // constraint.
+  bool changed = false;
+  for(uint64_t groupIdx = 0; groupIdx < physicalAddresses->size(); groupIdx++) {
+    for(uint64_t physicalAddress : *(*physicalAddresses)[groupIdx]) {
+      changed = addAddress(groupIdx, physicalAddress) || changed;
+    }
+  }
+  return changed;
+}
+
+vector<uint64_t> *LinearSolver::getNullspace() {
+  // Bits that never change can not be used to distinguish banks, so they are
+  // left out of the solution.
+  return groupConstraints->getNullspace(varyingBits);
+}
+
+vector<uint64_t> *LinearSolver::getConstantSpace() {
+  return globalConstraints->getNullspace(varyingBits);
+}
+
+uint64_t LinearSolver::getNumberOfFunctions() {
+  return globalConstraints->getRank() - groupConstraints->getRank();
+}
+
+uint64_t LinearSolver::getGroupParity(uint64_t mask, uint64_t groupIdx) {
+  return xorBits((*anchors)[groupIdx] & mask);
+}
+
+bool LinearSolver::splitsGroupsEqually(uint64_t mask) {
+  uint64_t nOnes = 0;
+  uint64_t nZeroes = 0;
+  for(uint64_t groupIdx = 0; groupIdx < anchors->size(); groupIdx++) {
+    if(!(*hasAnchor)[groupIdx]) {
+      continue;
+    }
+    if(getGroupParity(mask, groupIdx) == 1) {
+      nOnes++;
+    } else {
+      nZeroes++;
+    }
+  }
+  return nOnes == nZeroes;
+}
+
+vector<uint64_t> *LinearSolver::getFunctions() {
+  vector<uint64_t> *functions = new vector<uint64_t>();
+  vector<uint64_t> *nullspace = getNullspace();
+  vector<uint64_t> *constantSpace = getConstantSpace();
+
+  // Masks that only differ by a constant combination of bits are equivalent.
+  // Therefore, only one function per coset of the constant space is kept.
+  GF2Basis quotient;
+  for(uint64_t constant : *constantSpace) {
+    quotient.addVector(constant);
+  }
+  for(uint64_t nullVector : *nullspace) {
+    if(quotient.addVector(nullVector)) {
+      functions->push_back(nullVector);
+    }
+  }
+
+  delete nullspace;
+  delete constantSpace;
+  return functions;
+}
+
+vector<uint64_t> *LinearSolver::getMaskCandidates() {
+  vector<uint64_t> *candidates = new vector<uint64_t>();
+  vector<uint64_t> *constantSpace = getConstantSpace();
+
+  // Only one function per coset of the constant space is enumerated.
+  vector<uint64_t> *functionBasis = getFunctions();
+  vector<uint64_t> functions(*functionBasis);
+  delete functionBasis;
+  if(functions.size() > MAX_FUNCTION_SPACE_DIMENSION) {
+    printLogMessage(LOG_WARNING, "The solution space has " + to_string(functions.size()) + " dimensions, only the first " + to_string(MAX_FUNCTION_SPACE_DIMENSION) + " are used.");
+    functions.resize(MAX_FUNCTION_SPACE_DIMENSION);
+  }
+
+  // When the constant space is small enough, all of its combinations are
+  // enumerated to report every minimal mask (like the brute force search
+  // does). Otherwise, the weight of each mask is reduced greedily.
+  vector<uint64_t> constants;
+  bool enumerateConstants = constantSpace->size() <= MAX_CONSTANT_SPACE_DIMENSION;
+  if(enumerateConstants) {
+    constants.push_back(0);
+    for(uint64_t constant : *constantSpace) {
+      uint64_t nConstants = constants.size();
+      for(uint64_t i = 0; i < nConstants; i++) {
+        constants.push_back(constants[i] ^ constant);
+      }
+    }
+  }
+
+  for(uint64_t combination = 1; combination < (1UL<<functions.size()); combination++) {
+    uint64_t mask = 0;
+    for(uint64_t i = 0; i < functions.size(); i++) {
+      if(combination>>i&1) {
+        mask ^= functions[i];
+      }
+    }
+
+    // Adding a constant combination flips the result of all groups or none,
+    // so the split is the same for the whole coset.
+    if(!splitsGroupsEqually(mask)) {
+      continue;
+    }
+
+    if(!enumerateConstants) {
+      bool reduced = true;
+      while(reduced) {
+        reduced = false;
+        for(uint64_t constant : *constantSpace) {
+          if(countBits(mask ^ constant) < countBits(mask)) {
+            mask ^= constant;
+            reduced = true;
+          }
+        }
+      }
+      candidates->push_back(mask);
+      continue;
+    }
+
+    for(uint64_t offset : constants) {
+      uint64_t candidate = mask ^ offset;
+
+      // The candidate is only minimal when no subset of its bits is constant
+      // (otherwise, removing these bits would result in an equivalent mask).
+      bool isMinimal = true;
+      for(uint64_t constant : constants) {
+        if(constant != 0 && (constant & ~candidate) == 0) {
+          isMinimal = false;
+          break;
+        }
+      }
+      if(isMinimal) {
+        candidates->push_back(candidate);
+      }
+    }
+  }
+
+  // The brute force search only finds masks up to a maximum number of bits.
+  // To report comparable functions, only candidates up to the smallest weight
+  // that is sufficient to span all functions are kept.
+  sort(candidates->begin(), candidates->end(), [](uint64_t a, uint64_t b) {
+    return countBits(a) < countBits(b) || (countBits(a) == countBits(b) && a < b);
+  });
+  GF2Basis span;
+  uint64_t nCandidates = 0;
+  while(nCandidates < candidates->size() && span.getRank() < functions.size()) {
+    span.addVector((*candidates)[nCandidates]);
+    nCandidates++;
+  }
+  while(nCandidates < candidates->size() && countBits((*candidates)[nCandidates]) == countBits((*candidates)[nCandidates - 1])) {
+    nCandidates++;
+  }
+  candidates->resize(nCandidates);
+
+  delete constantSpace;
+  return candidates;
+}
@@ -0,0 +1,41 @@
+#ifndef LINEAR_SOLVER_H
+#define LINEAR_SOLVER_H
+
+#include<cstdint>
+#include<vector>
+
+#include "gf2Basis.h"
+
+using namespace std;
+
+/**
+ * LinearSolver derives linear bank functions from grouped physical addresses
+ * over GF(2). The XOR of two addresses within the same group has to be in the
+ * nullspace of every bank function, so the functions are obtained from the
+ * nullspace of all these differences instead of enumerating mask candidates.
+ */
+class LinearSolver {
+  private:
+    uint64_t columns;
+    uint64_t varyingBits;
+    uint64_t globalAnchor;
+    bool hasGlobalAnchor;
+    vector<uint64_t> *anchors;
+    vector<bool> *hasAnchor;
+    GF2Basis *groupConstraints;
+    GF2Basis *globalConstraints;
+    uint64_t getGroupParity(uint64_t mask, uint64_t groupIdx);
+    bool splitsGroupsEqually(uint64_t mask);
+  public:
+    LinearSolver(uint64_t columns);
+    ~LinearSolver();
+    bool addAddress(uint64_t groupIdx, uint64_t physicalAddress);
+    bool addGroups(vector<vector<uint64_t>*> *physicalAddresses);
+    vector<uint64_t> *getNullspace();
+    vector<uint64_t> *getConstantSpace();
+    uint64_t getNumberOfFunctions();
+    vector<uint64_t> *getFunctions();
+    vector<uint64_t> *getMaskCandidates();
+};
+
+#endif
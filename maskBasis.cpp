@@ -0,0 +1,74 @@
+#include<cstdint>
+#include<vector>
+#include<mutex>
+#include<atomic>
+#include<unordered_set>
+
+#include "maskBasis.h"
+
+using namespace std;
+
+MaskBasis::MaskBasis(BitSlicedAddresses *bitSlicedAddresses, uint64_t nBanks) {
+  this->basis = new GF2Basis();
+  this->masks = new vector<uint64_t>();
+  this->bitSlicedAddresses = bitSlicedAddresses;
+  this->nFunctions = 0;
+  while((1UL<<nFunctions) < nBanks) {
+    nFunctions++;
+  }
+  this->complete = false;
+}
+
+MaskBasis::~MaskBasis() {
+  delete basis;
+  delete masks;
+}
+
+bool MaskBasis::addMask(uint64_t mask) {
+  basisMutex.lock();
+  if(complete || !basis->addVector(mask)) {
+    // The mask is a combination of masks that were already found
+    basisMutex.unlock();
+    return false;
+  }
+  masks->push_back(mask);
+
+  if(basis->getRank() >= nFunctions && separatesAllGroups()) {
+    complete = true;
+  }
+  basisMutex.unlock();
+  return true;
+}
+
+bool MaskBasis::separatesAllGroups() {
+  // Every group gets the index built from the majority results of all masks.
+  // The basis is only complete when no two groups share an index.
+  unordered_set<uint64_t> bankIndices;
+  for(uint64_t groupIdx = 0; groupIdx < bitSlicedAddresses->getNumberOfGroups(); groupIdx++) {
+    uint64_t groupSize = bitSlicedAddresses->getGroupSize(groupIdx);
+    if(groupSize == 0) {
+      continue;
+    }
+    uint64_t bankIndex = 0;
+    for(uint64_t i = 0; i < masks->size(); i++) {
+      if(bitSlicedAddresses->countOnes((*masks)[i], groupIdx) * 2 > groupSize) {
+        bankIndex |= (1UL<<i);
+      }
+    }
+    if(!bankIndices.insert(bankIndex).second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool MaskBasis::isComplete() {
+  return complete.load(memory_order_relaxed);
+}
+
+uint64_t MaskBasis::getRank() {
+  basisMutex.lock();
+  uint64_t rank = basis->getRank();
+  basisMutex.unlock();
+  return rank;
+}
@@ -0,0 +1,39 @@
+#ifndef MASK_BASIS_H
+#define MASK_BASIS_H
+
+#include<cstdint>
+#include<vector>
+#include<mutex>
+#include<atomic>
+
+#include "gf2Basis.h"
+#include "bitSlicedAddresses.h"
+
+using namespace std;
+
+/**
+ * MaskBasis collects the valid masks found by all mask threads in an
+ * incremental row echelon basis. The basis is complete as soon as it has
+ * log2(number of banks) independent masks and these masks assign a different
+ * bank index to every group. The search still evaluates all candidates with
+ * the number of bits it is at, so a lighter mask is never left out for a
+ * combination of masks that happened to be found first.
+ */
+class MaskBasis {
+  private:
+    GF2Basis *basis;
+    vector<uint64_t> *masks;
+    BitSlicedAddresses *bitSlicedAddresses;
+    uint64_t nFunctions;
+    atomic<bool> complete;
+    mutex basisMutex;
+    bool separatesAllGroups();
+  public:
+    MaskBasis(BitSlicedAddresses *bitSlicedAddresses, uint64_t nBanks);
+    ~MaskBasis();
+    bool addMask(uint64_t mask);
+    bool isComplete();
+    uint64_t getRank();
+};
+
+#endif
@@ -0,0 +1,286 @@
+#include<cstdint>
+#include<vector>
+#include<deque>
+#include<mutex>
+#include<atomic>
+#include<condition_variable>
+
+#include "maskScheduler.h"
+
+using namespace std;
+
+// Number of candidates a thread takes from its queue at once
+#define MASK_CHUNK_SIZE 4096
+
+MaskScheduler::MaskScheduler(uint64_t alphabet, uint64_t maxMaskBits, uint64_t nThreads, uint64_t shardIdx, uint64_t nShards) {
+  this->alphabet = alphabet;
+  this->nAlphabetBits = __builtin_popcountl(alphabet);
+  this->maxMaskBits = maxMaskBits;
+  this->shardIdx = shardIdx;
+  this->nShards = nShards;
+  this->alphabetShift = alphabet == 0 ? 0 : __builtin_ctzl(alphabet);
+  this->alphabetIsContiguous = ((alphabet >> alphabetShift) & ((alphabet >> alphabetShift) + 1)) == 0;
+  this->nThreads = nThreads;
+  this->chunkSize = MASK_CHUNK_SIZE;
+  this->nCandidates = 0;
+  this->nSteals = 0;
+  this->nScheduledCandidates = 0;
+  this->currentBits = 0;
+  this->nRemainingCandidates = 0;
+  this->stopped = false;
+
+  for(uint64_t n = 0; n <= 64; n++) {
+    for(uint64_t k = 0; k <= 64; k++) {
+      if(k > n) {
+        binomials[n][k] = 0;
+      } else if(k == 0 || k == n) {
+        binomials[n][k] = 1;
+      } else {
+        binomials[n][k] = binomials[n - 1][k - 1] + binomials[n - 1][k];
+      }
+    }
+  }
+
+  queues = new vector<deque<MaskRange>*>();
+  queueMutexes = new vector<mutex*>();
+  for(uint64_t i = 0; i < nThreads; i++) {
+    queues->push_back(new deque<MaskRange>());
+    queueMutexes->push_back(new mutex());
+  }
+  rangeSizes = new vector<uint64_t>(nThreads, 0);
+
+  // The candidates of each number of bits are split equally between all
+  // shards
+  for(uint64_t nBits = 1; nBits <= maxMaskBits && nBits <= nAlphabetBits; nBits++) {
+    nCandidates += binomials[nAlphabetBits][nBits] * (shardIdx + 1) / nShards - binomials[nAlphabetBits][nBits] * shardIdx / nShards;
+  }
+  this->finished = !scheduleNextNumberOfBits();
+}
+
+MaskScheduler::~MaskScheduler() {
+  for(uint64_t i = 0; i < nThreads; i++) {
+    delete (*queues)[i];
+    delete (*queueMutexes)[i];
+  }
+  delete queues;
+  delete queueMutexes;
+  delete rangeSizes;
+}
+
+bool MaskScheduler::scheduleNextNumberOfBits() {
+  // The candidates of the shard with the next number of bits are split
+  // equally between all threads. Numbers of bits without candidates in this
+  // shard are skipped.
+  while(currentBits < maxMaskBits && currentBits < nAlphabetBits) {
+    currentBits++;
+    uint64_t shardBegin = binomials[nAlphabetBits][currentBits] * shardIdx / nShards;
+    uint64_t nMasks = binomials[nAlphabetBits][currentBits] * (shardIdx + 1) / nShards - shardBegin;
+    if(nMasks == 0) {
+      continue;
+    }
+    nRemainingCandidates = nMasks;
+    for(uint64_t i = 0; i < nThreads; i++) {
+      MaskRange range = {currentBits, shardBegin + nMasks * i / nThreads, shardBegin + nMasks * (i + 1) / nThreads};
+      if(range.begin < range.end) {
+        (*queueMutexes)[i]->lock();
+        (*queues)[i]->push_back(range);
+        (*queueMutexes)[i]->unlock();
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+bool MaskScheduler::getNextRange(uint64_t threadId, MaskRange *range) {
+  // The previous range of the thread was evaluated. The thread that evaluated
+  // the last candidate with the current number of bits schedules the next one.
+  unique_lock<mutex> lock(weightMutex);
+  nRemainingCandidates -= (*rangeSizes)[threadId];
+  (*rangeSizes)[threadId] = 0;
+  if(nRemainingCandidates == 0 && !finished) {
+    finished = !scheduleNextNumberOfBits();
+    weightCondition.notify_all();
+  }
+
+  while(!stopped && !finished) {
+    uint64_t nBits = currentBits;
+    lock.unlock();
+    if(takeRange(threadId, range)) {
+      (*rangeSizes)[threadId] = range->end - range->begin;
+      return true;
+    }
+    lock.lock();
+    // All candidates with the current number of bits were handed out, but
+    // other threads are still evaluating them
+    while(!stopped && !finished && currentBits == nBits) {
+      weightCondition.wait(lock);
+    }
+  }
+  return false;
+}
+
+void MaskScheduler::stop() {
+  weightMutex.lock();
+  stopped = true;
+  weightMutex.unlock();
+  weightCondition.notify_all();
+}
+
+bool MaskScheduler::takeRange(uint64_t threadId, MaskRange *range) {
+  deque<MaskRange> *queue = (*queues)[threadId];
+  (*queueMutexes)[threadId]->lock();
+  if(queue->empty()) {
+    (*queueMutexes)[threadId]->unlock();
+    return stealRange(threadId, range);
+  }
+
+  MaskRange *front = &queue->front();
+  range->nBits = front->nBits;
+  range->begin = front->begin;
+  range->end = front->end - front->begin > chunkSize ? front->begin + chunkSize : front->end;
+  front->begin = range->end;
+  if(front->begin == front->end) {
+    queue->pop_front();
+  }
+  (*queueMutexes)[threadId]->unlock();
+  nScheduledCandidates += range->end - range->begin;
+  return true;
+}
+
+bool MaskScheduler::stealRange(uint64_t threadId, MaskRange *range) {
+  for(uint64_t offset = 1; offset < nThreads; offset++) {
+    uint64_t victimId = (threadId + offset) % nThreads;
+    deque<MaskRange> *victimQueue = (*queues)[victimId];
+
+    (*queueMutexes)[victimId]->lock();
+    if(victimQueue->empty()) {
+      (*queueMutexes)[victimId]->unlock();
+      continue;
+    }
+
+    // Take the back half of the last range of the victim. The victim works on
+    // the front, so both threads do not get in each other's way.
+    MaskRange *back = &victimQueue->back();
+    MaskRange stolen = *back;
+    if(back->end - back->begin > chunkSize) {
+      stolen.begin = back->begin + (back->end - back->begin) / 2;
+      back->end = stolen.begin;
+    } else {
+      victimQueue->pop_back();
+    }
+    (*queueMutexes)[victimId]->unlock();
+    nSteals++;
+
+    range->nBits = stolen.nBits;
+    range->begin = stolen.begin;
+    range->end = stolen.end - stolen.begin > chunkSize ? stolen.begin + chunkSize : stolen.end;
+    if(range->end != stolen.end) {
+      stolen.begin = range->end;
+      (*queueMutexes)[threadId]->lock();
+      (*queues)[threadId]->push_back(stolen);
+      (*queueMutexes)[threadId]->unlock();
+    }
+    nScheduledCandidates += range->end - range->begin;
+    return true;
+  }
+  return false;
+}
+
+uint64_t MaskScheduler::getCompactMask(uint64_t nBits, uint64_t rank) {
+  // Unrank the combination in colexicographic order: the highest bit is the
+  // largest position c with binomial(c, nBits) <= rank, and so on.
+  uint64_t compactMask = 0;
+  uint64_t position = nAlphabetBits;
+  for(uint64_t i = nBits; i > 0; i--) {
+    do {
+      position--;
+    } while(binomials[position][i] > rank);
+    compactMask |= (1UL<<position);
+    rank -= binomials[position][i];
+  }
+  return compactMask;
+}
+
+uint64_t MaskScheduler::getRevolvingDoorMask(uint64_t nBits, uint64_t rank, uint64_t *elements) {
+  // Unrank the combination in revolving door order (Kreher and Stinson,
+  // Combinatorial Algorithms, Algorithm 2.12). elements stores the positions
+  // of the bits (starting at 1) in elements[1] to elements[nBits].
+  uint64_t compactMask = 0;
+  uint64_t position = nAlphabetBits;
+  for(uint64_t i = nBits; i > 0; i--) {
+    while(binomials[position][i] > rank) {
+      position--;
+    }
+    elements[i] = position + 1;
+    compactMask |= (1UL<<position);
+    rank = binomials[position + 1][i] - rank - 1;
+  }
+  return compactMask;
+}
+
+uint64_t MaskScheduler::getNextRevolvingDoorMask(uint64_t nBits, uint64_t *elements) {
+  // Successor in revolving door order (Kreher and Stinson, Algorithm 2.13).
+  // elements needs space for nBits + 2 entries.
+  elements[nBits + 1] = nAlphabetBits + 1;
+  uint64_t j = 1;
+  while(j <= nBits && elements[j] == j) {
+    j++;
+  }
+  if((nBits - j) % 2 != 0) {
+    if(j == 1) {
+      elements[1]--;
+    } else {
+      elements[j - 1] = j;
+      elements[j - 2] = j - 1;
+    }
+  } else {
+    if(elements[j + 1] != elements[j] + 1) {
+      elements[j - 1] = elements[j];
+      elements[j]++;
+    } else {
+      elements[j + 1] = elements[j];
+      elements[j] = j;
+    }
+  }
+
+  uint64_t compactMask = 0;
+  for(uint64_t i = 1; i <= nBits; i++) {
+    compactMask |= (1UL<<(elements[i] - 1));
+  }
+  return compactMask;
+}
+
+uint64_t MaskScheduler::depositBits(uint64_t compactMask) {
+  if(alphabetIsContiguous) {
+    return compactMask << alphabetShift;
+  }
+
+  uint64_t mask = 0;
+  uint64_t remainingAlphabet = alphabet;
+  while(compactMask != 0) {
+    uint64_t alphabetBit = remainingAlphabet & -remainingAlphabet;
+    if(compactMask & 1) {
+      mask |= alphabetBit;
+    }
+    remainingAlphabet ^= alphabetBit;
+    compactMask >>= 1;
+  }
+  return mask;
+}
+
+uint64_t MaskScheduler::getMask(uint64_t compactMask) {
+  return depositBits(compactMask);
+}
+
+uint64_t MaskScheduler::getNumberOfCandidates() {
+  return nCandidates;
+}
+
+uint64_t MaskScheduler::getNumberOfSteals() {
+  return nSteals;
+}
+
+uint64_t MaskScheduler::getNumberOfScheduledCandidates() {
+  return nScheduledCandidates;
+}
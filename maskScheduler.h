@@ -0,0 +1,86 @@
+#ifndef MASK_SCHEDULER_H
+#define MASK_SCHEDULER_H
+
+#include<cstdint>
+#include<vector>
+#include<deque>
+#include<mutex>
+#include<atomic>
+#include<condition_variable>
+
+using namespace std;
+
+/**
+ * A MaskRange describes a contiguous part of the candidates with nBits bits
+ * set. begin and end are ranks in colexicographic order (which is the order
+ * of generateNextAddressMaskWithSameNumberOfBits).
+ */
+struct MaskRange {
+  uint64_t nBits;
+  uint64_t begin;
+  uint64_t end;
+};
+
+/**
+ * MaskScheduler distributes the mask candidates between the mask threads. The
+ * candidates are addressed by their rank (combinadic), so each thread can
+ * start at an arbitrary candidate without enumerating the ones before.
+ *
+ * The candidates are handed out by their number of bits: the candidates with
+ * nBits + 1 bits are only scheduled after all candidates with nBits bits were
+ * evaluated by all threads. The candidates with the current number of bits
+ * are split between the threads; each thread owns a queue of ranges and takes
+ * chunks from the front, threads without work steal the back half of the last
+ * range of another thread. Threads without candidates left wait until the
+ * next number of bits is scheduled.
+ *
+ * The candidates can be split into shards (e.g. for several processes), each
+ * scheduler then only hands out the candidates of its own shard.
+ *
+ * Ranks can either be interpreted in colexicographic order or in revolving
+ * door order, where two consecutive candidates only differ by one removed and
+ * one added bit.
+ */
+class MaskScheduler {
+  private:
+    uint64_t alphabet;
+    uint64_t nAlphabetBits;
+    uint64_t maxMaskBits;
+    uint64_t shardIdx;
+    uint64_t nShards;
+    uint64_t alphabetShift;
+    bool alphabetIsContiguous;
+    uint64_t nThreads;
+    uint64_t chunkSize;
+    uint64_t nCandidates;
+    uint64_t binomials[65][65];
+    vector<deque<MaskRange>*> *queues;
+    vector<mutex*> *queueMutexes;
+    vector<uint64_t> *rangeSizes;
+    uint64_t currentBits;
+    uint64_t nRemainingCandidates;
+    bool finished;
+    bool stopped;
+    mutex weightMutex;
+    condition_variable weightCondition;
+    atomic<uint64_t> nSteals;
+    atomic<uint64_t> nScheduledCandidates;
+    bool scheduleNextNumberOfBits();
+    bool takeRange(uint64_t threadId, MaskRange *range);
+    bool stealRange(uint64_t threadId, MaskRange *range);
+    uint64_t depositBits(uint64_t compactMask);
+  public:
+    MaskScheduler(uint64_t alphabet, uint64_t maxMaskBits, uint64_t nThreads, uint64_t shardIdx = 0, uint64_t nShards = 1);
+    ~MaskScheduler();
+    bool getNextRange(uint64_t threadId, MaskRange *range);
+    void stop();
+    uint64_t getCompactMask(uint64_t nBits, uint64_t rank);
+    uint64_t getRevolvingDoorMask(uint64_t nBits, uint64_t rank, uint64_t *elements);
+    uint64_t getNextRevolvingDoorMask(uint64_t nBits, uint64_t *elements);
+    uint64_t getMask(uint64_t compactMask);
+    uint64_t getNumberOfCandidates();
+    uint64_t getNumberOfSteals();
+    uint64_t getNumberOfScheduledCandidates();
+};
+
+#endif
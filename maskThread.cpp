@@ -1,22 +1,43 @@
+#include<cstdlib>
+#include<cstring>
+
 #include "maskThread.h"
 #include "helper.h"
 #include "config.h"
 
-MaskThread::MaskThread(Config *config, uint64_t threadId, uint64_t skipLastNBits, vector<vector<uint64_t>*> *physicalAddresses, vector<uint64_t> *validMasks, mutex *validMasksMutex) {
+MaskThread::MaskThread(Config *config, uint64_t threadId, uint64_t skipLastNBits, vector<vector<uint64_t>*> *physicalAddresses, BitSlicedAddresses *bitSlicedAddresses, BitSlicedAddresses *sampledAddresses, MaskScheduler *maskScheduler, MaskBasis *maskBasis, vector<uint64_t> *validMasks, mutex *validMasksMutex) {
   this->threadId = threadId;
   this->config = config;
   this->skipLastNBits = skipLastNBits;
 	this->physicalAddresses = physicalAddresses;
+  this->bitSlicedAddresses = bitSlicedAddresses;
+  this->sampledAddresses = sampledAddresses;
+  this->nSampleChecks = 0;
+  this->nSampleRejects = 0;
+  this->maskScheduler = maskScheduler;
+  this->maskBasis = maskBasis;
 	this->validMasks = validMasks;
 	this->validMasksMutex = validMasksMutex;
 	this->myThread = NULL;
-  this->maxBits = (sizeof(uint64_t) * 8) - this->skipLastNBits - 1;
+  this->parities = NULL;
+  this->parityMasks = NULL;
+
+  // In revolving door order, the parities of all addresses are kept per
+  // thread and updated with the bits that changed since the last evaluation of
+  // each group. Initially, they are zero (the parities of mask 0).
+  if(config->getMaskOrder() == MASK_ORDER_REVOLVING_DOOR) {
+    uint64_t nBytes = bitSlicedAddresses->getNumberOfWords() * sizeof(uint64_t) + 64;
+    parities = (uint64_t *)aligned_alloc(64, nBytes);
+    memset(parities, 0, nBytes);
+    parityMasks = new vector<uint64_t>(bitSlicedAddresses->getNumberOfGroups(), 0);
+  }
 
   setThreadReference(new thread(&MaskThread::runAsThread, this));
 }
 
 MaskThread::~MaskThread() {
-
+  free(parities);
+  delete parityMasks;
 }
 
 // Code from https://github.com/IAIK/drama/blob/master/re/measure.cpp
@@ -32,122 +53,125 @@ uint64_t MaskThread::generateNextAddressMaskWithSameNumberOfBits(uint64_t addres
     return ripple | ones;
 }
 
-uint64_t MaskThread::generateNextAddressMask(uint64_t lastMask, int64_t nSkip) {
-  lastMask >>= skipLastNBits;
-  while(nSkip >= 0) {
-    lastMask = generateNextAddressMaskWithSameNumberOfBits(lastMask);
-    if(lastMask > (1UL<<(maxBits + 1)) - 1) {
-      uint64_t nBits = countBits(lastMask) + 1;
-      if(nBits == config->getMaximumNumberOfMaskBits() + 1) {
-        return 0;
-      }
+bool MaskThread::checkModifiedMasks(uint64_t mask) {
+  // A modified mask (the mask with some bits set to 0) is equivalent (or
+  // inverse equivalent) to the mask when the removed bits produce the same
+  // result for all physical addresses. So the mask is only minimal when no
+  // non-empty proper subset of its bits is constant. It does not matter if the
+  // modified mask is valid or not, it is only important that it does not
+  // produce the same result than a mask with fewer bits set (in that case, the
+  // mask with fewer bits is added when it is the minimal one).
+  //
+  // The subsets are enumerated once with (subset - 1) & mask. Their
+  // signatures are updated from the signatures of single bits and the prefix
+  // signatures below the lowest bit, so no subset has to be evaluated over all
+  // addresses unless its signature shows that it might be constant.
+  uint64_t bitSignatures[64];
+  uint64_t prefixSignatures[65];
+  prefixSignatures[0] = 0;
+  uint64_t nBits = 0;
+  for(uint64_t remainingBits = mask; remainingBits != 0; remainingBits &= remainingBits - 1) {
+    bitSignatures[nBits] = bitSlicedAddresses->getColumnSignature(__builtin_ctzl(remainingBits));
+    prefixSignatures[nBits + 1] = prefixSignatures[nBits] ^ bitSignatures[nBits];
+    nBits++;
+  }
+  uint64_t onesSignature = bitSlicedAddresses->getOnesSignature();
 
-      lastMask = 1;
-      // Set the nBits right bits to 1
-      for(uint64_t i = 1; i < nBits; i++) {
-        lastMask <<= 1;
-        lastMask += 1;
-      }
+  uint64_t subset = mask;
+  uint64_t subsetSignature = prefixSignatures[nBits];
+  while(true) {
+    // (subset - 1) & mask clears the lowest bit of the subset and sets all bits
+    // of the mask below it.
+    uint64_t lowestBitIdx = __builtin_popcountl(mask & ((subset & -subset) - 1));
+    subsetSignature ^= bitSignatures[lowestBitIdx] ^ prefixSignatures[lowestBitIdx];
+    subset = (subset - 1) & mask;
+    if(subset == 0) {
+      break;
+    }
+
+    if((subsetSignature == 0 || subsetSignature == onesSignature) && bitSlicedAddresses->isConstant(subset)) {
+      // The mask is equivalent, so at least one equivalent mask was identified.
+      return false;
     }
-    nSkip--;
   }
-  return lastMask<<skipLastNBits;
+
+	return true;
 }
 
-vector<uint64_t> *MaskThread::getModifiedMasks(uint64_t mask, bool recursive, vector<uint64_t> *modifiedMasks) {
-	if(modifiedMasks == NULL) {
-		modifiedMasks = new vector<uint64_t>();
-	}
-
-	if(mask == 0) {
-		return modifiedMasks;
-	}
-
-  uint64_t tmpMask = 0;
-  for(uint64_t i = 0; i < sizeof(uint64_t) * 8; i++) {
-		if(mask & (1UL<<i)) {
-			tmpMask = mask & (~(1UL<<i));
-			if(recursive) {
-				modifiedMasks = getModifiedMasks(tmpMask, recursive, modifiedMasks);
-			} if(tmpMask != 0) {
-				modifiedMasks->push_back(tmpMask);
-			}
-		}
+uint64_t MaskThread::countOnes(uint64_t mask, uint64_t groupIdx, uint64_t *firstParity) {
+  if(parities == NULL) {
+    return bitSlicedAddresses->countOnes(mask, groupIdx, firstParity);
+  }
+
+  // Groups are only updated when they are evaluated (most candidates already
+  // fail in the first groups). When more bits changed since the last update
+  // than the mask has, the parities are computed from scratch.
+  uint64_t changedBits = (*parityMasks)[groupIdx] ^ mask;
+  if(changedBits == 0) {
+    return bitSlicedAddresses->countOnesInParities(parities, groupIdx, firstParity);
   }
-  return modifiedMasks;
+  (*parityMasks)[groupIdx] = mask;
+  if(countBits(changedBits) < countBits(mask)) {
+    return bitSlicedAddresses->updateParities(parities, changedBits, groupIdx, false, firstParity);
+  }
+  return bitSlicedAddresses->updateParities(parities, mask, groupIdx, true, firstParity);
 }
 
-bool MaskThread::checkModifiedMasks(uint64_t mask, bool recursive) {
-	// This function should be called with the default value for recursive, e.g.
-	// false. It gets modified masks without recursion (e.g. where only one bit
-	// is set to 0) first in order to increase speed. If the mask was valid with
-	// one bit set to 0, it calls checkModifiedMasks again and sets recursive to
-	// true to check the other combinations as well. Since most masks should be
-	// equivalent to another one with one bit fewer set, this should improve the
-	// performance significantly.
-  vector<uint64_t> *modifiedMasks = getModifiedMasks(mask, recursive);
-  for(uint64_t modifiedMask: *modifiedMasks) {
-    bool maskIsEquivalent = true;
-    bool maskIsInverseEquivalent = true;
-    for(vector<uint64_t> *physicalAddressGroup : *physicalAddresses) {
-      for(uint64_t physicalAddress: *physicalAddressGroup) {
-        if(xorBits(physicalAddress & mask) != xorBits(physicalAddress & modifiedMask)) {
-          // Results of the mask and modified mask differ, so they are not
-          // equivalent. It does not matter if the modified mask is valid or
-          // not, it is only important that it does not produce the same result
-          // than a mask with fewer bits set (in that case, the mask with fewer
-          // bits is added when it is the minimal one).
-          maskIsEquivalent = false;
-        } else {
-          maskIsInverseEquivalent = false;
-        }
-      }
+bool MaskThread::checkSample(uint64_t mask) {
+  // The sample of each group starts with the first address of the group, so
+  // the errors within the sample are a subset of the errors within the group.
+  // When the sample already has more errors than allowed for the whole group,
+  // checkMask would reject the mask as well.
+  for(uint64_t groupIdx = 0; groupIdx < sampledAddresses->getNumberOfGroups(); groupIdx++) {
+    uint64_t sampleSize = sampledAddresses->getGroupSize(groupIdx);
+    if(sampleSize == 0) {
+      continue;
     }
+    uint64_t groupResult = 0;
+    uint64_t nOnesInSample = sampledAddresses->countOnes(mask, groupIdx, &groupResult);
+    uint64_t nErrors = groupResult == 1 ? sampleSize - nOnesInSample : nOnesInSample;
 
-    if(maskIsEquivalent || maskIsInverseEquivalent) {
-      // The mask is equivalent, so at least one equivalent mask was identified.
-			delete modifiedMasks;
+    uint64_t groupSize = bitSlicedAddresses->getGroupSize(groupIdx);
+    uint64_t maxErrors = groupSize * config->getMaximumErrorPercentageForValidMasks() / 100;
+    if(nErrors > maxErrors && maxErrors + 1 < groupSize - maxErrors) {
       return false;
     }
   }
-
-  delete modifiedMasks;
-
-	if(!recursive) {
-		return checkModifiedMasks(mask, true);
-	}
-
-	return true;
+  return true;
 }
 
 bool MaskThread::checkMask(uint64_t mask) {
+  if(sampledAddresses != NULL) {
+    nSampleChecks++;
+    if(!checkSample(mask)) {
+      nSampleRejects++;
+      return false;
+    }
+  }
+
   uint64_t nOnes = 0;
   uint64_t nZeroes = 0;
-  for(vector<uint64_t> *physicalAddressGroup : *physicalAddresses) {
-    if(physicalAddressGroup->size() == 0) {
+  for(uint64_t groupIdx = 0; groupIdx < bitSlicedAddresses->getNumberOfGroups(); groupIdx++) {
+    uint64_t groupSize = bitSlicedAddresses->getGroupSize(groupIdx);
+    if(groupSize == 0) {
       continue;
     }
-    uint64_t groupResult = xorBits((*physicalAddressGroup)[0] & mask);
+    uint64_t groupResult = 0;
+    uint64_t nOnesInGroup = countOnes(mask, groupIdx, &groupResult);
 
     // nErrors is used to count the number of physical addresses within the
     // group with another result than the first one. It should be noted that the
     // first one can also be wrong, so the number of errors should either be
     // smaller than the limit or (if inverse) bigger than the number of physical
     // addresses in the group minus the limit.
-    uint64_t nErrors = 0;
-    uint64_t maxErrors = physicalAddressGroup->size() * config->getMaximumErrorPercentageForValidMasks() / 100;
-    for(uint64_t i = 1; i <  physicalAddressGroup->size(); i++) {
-      uint64_t physicalAddress = (*physicalAddressGroup)[i];
-      if(xorBits(physicalAddress & mask) != groupResult) {
-        // Not the same result for all addresses within one group
-        nErrors++;
-        if(nErrors > maxErrors && nErrors < physicalAddressGroup->size() - maxErrors) {
-          return false;
-        }
-      }
+    uint64_t nErrors = groupResult == 1 ? groupSize - nOnesInGroup : nOnesInGroup;
+    uint64_t maxErrors = groupSize * config->getMaximumErrorPercentageForValidMasks() / 100;
+    if(nErrors > maxErrors && maxErrors + 1 < groupSize - maxErrors) {
+      // Not the same result for all addresses within one group (the number of
+      // errors passed the range between both limits)
+      return false;
     }
 
-
     // The group has an overall result of one when the result was one and the
     // number of errors was below the limit (no inversion) or when the result
     // was zero and the number of errors above the inverted limit (with
@@ -169,24 +193,53 @@ bool MaskThread::checkMask(uint64_t mask) {
 }
 
 void MaskThread::scanForMasks() {
-  uint64_t maskCandidate = 1UL << skipLastNBits;
-  uint64_t state = 0;
-	while(maskCandidate != 0) {
-    if(state == 0) {
-      state++;
-      maskCandidate = generateNextAddressMask(maskCandidate, this->threadId - 1);
+  // The scheduler hands out ranges of candidates by their rank. Only the first
+  // mask of a range is unranked, the following ones are generated directly.
+  MaskRange range;
+  uint64_t elements[66];
+  uint64_t nBits = 0;
+  while(maskScheduler->getNextRange(threadId, &range)) {
+    // All candidates with fewer bits were evaluated by all threads when the
+    // first range with more bits is handed out. When the basis is complete
+    // then, no mask with more bits is needed, and the masks with the same
+    // number of bits were all found, so the result does not depend on which
+    // thread found its masks first.
+    if(maskBasis != NULL && range.nBits != nBits && maskBasis->isComplete()) {
+      maskScheduler->stop();
+      return;
+    }
+    nBits = range.nBits;
+
+    uint64_t compactMask = 0;
+    if(parities == NULL) {
+      compactMask = maskScheduler->getCompactMask(range.nBits, range.begin);
     } else {
-      maskCandidate = generateNextAddressMask(maskCandidate, this->config->getNumberOfThreadsForMaskCalculation() - 1);
+      compactMask = maskScheduler->getRevolvingDoorMask(range.nBits, range.begin, elements);
     }
 
-		if(!checkMask(maskCandidate)) {
-			continue;
-		}
+    for(uint64_t rank = range.begin; rank < range.end; rank++) {
+      uint64_t maskCandidate = maskScheduler->getMask(compactMask);
+      if(rank + 1 < range.end) {
+        if(parities == NULL) {
+          compactMask = generateNextAddressMaskWithSameNumberOfBits(compactMask);
+        } else {
+          compactMask = maskScheduler->getNextRevolvingDoorMask(range.nBits, elements);
+        }
+      }
+
+      if(!checkMask(maskCandidate)) {
+        continue;
+      }
+
+      validMasksMutex->lock();
+      validMasks->push_back(maskCandidate);
+      validMasksMutex->unlock();
 
-		validMasksMutex->lock();
-		validMasks->push_back(maskCandidate);		
-		validMasksMutex->unlock();
-	}
+      if(maskBasis != NULL) {
+        maskBasis->addMask(maskCandidate);
+      }
+    }
+  }
 }
 
 void MaskThread::runAsThread(MaskThread *maskThread) {
@@ -200,3 +253,11 @@ void MaskThread::setThreadReference(thread *thread) {
 thread *MaskThread::getThreadReference() {
 	return myThread;
 }
+
+uint64_t MaskThread::getNumberOfSampleChecks() {
+  return nSampleChecks;
+}
+
+uint64_t MaskThread::getNumberOfSampleRejects() {
+  return nSampleRejects;
+}
@@ -7,6 +7,9 @@
 #include<thread>
 
 #include "config.h"
+#include "bitSlicedAddresses.h"
+#include "maskScheduler.h"
+#include "maskBasis.h"
 
 using namespace std;
 
@@ -15,24 +18,33 @@ class MaskThread {
     Config *config;
     uint64_t threadId;
     uint64_t skipLastNBits;
-    uint64_t maxBits;
     uint64_t nMaskBits;
 		vector<vector<uint64_t>*> *physicalAddresses;
+    BitSlicedAddresses *bitSlicedAddresses;
+    BitSlicedAddresses *sampledAddresses;
+    uint64_t nSampleChecks;
+    uint64_t nSampleRejects;
+    MaskScheduler *maskScheduler;
+    MaskBasis *maskBasis;
 		vector<uint64_t> *validMasks;
 		mutex *validMasksMutex;
 		thread *myThread;
-    vector<uint64_t> *getModifiedMasks(uint64_t mask, bool recursive = false, vector<uint64_t> *modifiedMasks = NULL);
+    uint64_t *parities;
+    vector<uint64_t> *parityMasks;
+    uint64_t countOnes(uint64_t mask, uint64_t groupIdx, uint64_t *firstParity);
 		bool checkMask(uint64_t mask);
-		bool checkModifiedMasks(uint64_t mask, bool recursive = false);
+    bool checkSample(uint64_t mask);
+		bool checkModifiedMasks(uint64_t mask);
     uint64_t generateNextAddressMaskWithSameNumberOfBits(uint64_t addressMask);
-    uint64_t generateNextAddressMask(uint64_t lastMask, int64_t nSkip);
 	public:
-		MaskThread(Config *config, uint64_t threadId, uint64_t skipLastNBits, vector<vector<uint64_t>*> *physicalAddresses, vector<uint64_t> *validMasks, mutex *validMasksMutex);
+		MaskThread(Config *config, uint64_t threadId, uint64_t skipLastNBits, vector<vector<uint64_t>*> *physicalAddresses, BitSlicedAddresses *bitSlicedAddresses, BitSlicedAddresses *sampledAddresses, MaskScheduler *maskScheduler, MaskBasis *maskBasis, vector<uint64_t> *validMasks, mutex *validMasksMutex);
 		~MaskThread();
 		void scanForMasks();
 		static void runAsThread(MaskThread *maskThread);
 		void setThreadReference(thread *thread);
 		thread *getThreadReference();
+    uint64_t getNumberOfSampleChecks();
+    uint64_t getNumberOfSampleRejects();
 };
 
 #endif
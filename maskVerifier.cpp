@@ -0,0 +1,218 @@
+#include<cstdint>
+#include<vector>
+#include<thread>
+#include<random>
+#include<algorithm>
+#include<unordered_set>
+#include<unordered_map>
+
+#include "maskVerifier.h"
+#include "helper.h"
+
+using namespace std;
+
+// Seed of the bootstrap samples. Each sample uses its own generator, so the
+// results do not depend on the number of threads.
+#define BOOTSTRAP_SEED 0x626f6f74
+
+MaskVerifier::MaskVerifier(vector<vector<uint64_t>*> *physicalAddresses, vector<uint64_t> *masks) {
+  this->masks = new vector<uint64_t>(*masks);
+  this->signatures = new vector<vector<uint64_t>*>();
+  this->signatureCounts = new vector<vector<uint64_t>*>();
+  this->groupCodes = new vector<uint64_t>();
+  this->nAddresses = 0;
+  this->agreements = new vector<uint64_t>(masks->size(), 0);
+  this->nFullAgreements = 0;
+  this->confidenceIntervals = new vector<ConfidenceInterval>();
+  this->fullConfidenceInterval = {0, 0};
+
+  for(vector<uint64_t> *group : *physicalAddresses) {
+    // Most addresses of a group share the same results, so only the distinct
+    // signatures and how often they occur are stored.
+    unordered_map<uint64_t, uint64_t> signatureIndices;
+    vector<uint64_t> *groupSignatures = new vector<uint64_t>();
+    vector<uint64_t> *groupCounts = new vector<uint64_t>();
+    vector<uint64_t> nOnes(masks->size(), 0);
+    for(uint64_t address : *group) {
+      uint64_t signature = 0;
+      for(uint64_t i = 0; i < masks->size(); i++) {
+        if(xorBits(address & (*masks)[i]) == 1) {
+          signature |= (1UL<<i);
+          nOnes[i]++;
+        }
+      }
+      auto index = signatureIndices.find(signature);
+      if(index == signatureIndices.end()) {
+        signatureIndices[signature] = groupSignatures->size();
+        groupSignatures->push_back(signature);
+        groupCounts->push_back(1);
+      } else {
+        (*groupCounts)[index->second]++;
+      }
+    }
+
+    uint64_t groupCode = 0;
+    for(uint64_t i = 0; i < masks->size(); i++) {
+      if(nOnes[i] * 2 > group->size()) {
+        groupCode |= (1UL<<i);
+      }
+    }
+
+    for(uint64_t i = 0; i < groupSignatures->size(); i++) {
+      uint64_t difference = (*groupSignatures)[i] ^ groupCode;
+      for(uint64_t maskIdx = 0; maskIdx < masks->size(); maskIdx++) {
+        if((difference>>maskIdx&1) == 0) {
+          (*agreements)[maskIdx] += (*groupCounts)[i];
+        }
+      }
+      if(difference == 0) {
+        nFullAgreements += (*groupCounts)[i];
+      }
+    }
+
+    nAddresses += group->size();
+    signatures->push_back(groupSignatures);
+    signatureCounts->push_back(groupCounts);
+    groupCodes->push_back(groupCode);
+  }
+}
+
+MaskVerifier::~MaskVerifier() {
+  for(uint64_t groupIdx = 0; groupIdx < signatures->size(); groupIdx++) {
+    delete (*signatures)[groupIdx];
+    delete (*signatureCounts)[groupIdx];
+  }
+  delete signatures;
+  delete signatureCounts;
+  delete groupCodes;
+  delete masks;
+  delete agreements;
+  delete confidenceIntervals;
+}
+
+uint64_t MaskVerifier::getNumberOfAddresses() {
+  return nAddresses;
+}
+
+uint64_t MaskVerifier::getNumberOfDistinctGroupCodes() {
+  unordered_set<uint64_t> codes;
+  for(uint64_t groupIdx = 0; groupIdx < groupCodes->size(); groupIdx++) {
+    if(!(*signatures)[groupIdx]->empty()) {
+      codes.insert((*groupCodes)[groupIdx]);
+    }
+  }
+  return codes.size();
+}
+
+double MaskVerifier::getAgreementRate(uint64_t maskIdx) {
+  if(nAddresses == 0) {
+    return 0;
+  }
+  return (double)(*agreements)[maskIdx] / nAddresses;
+}
+
+double MaskVerifier::getAgreementRate() {
+  if(nAddresses == 0) {
+    return 0;
+  }
+  return (double)nFullAgreements / nAddresses;
+}
+
+void MaskVerifier::resample(uint64_t firstSample, uint64_t lastSample, vector<vector<double>> *rates) {
+  vector<uint64_t> sampleAgreements(masks->size(), 0);
+  for(uint64_t sample = firstSample; sample < lastSample; sample++) {
+    mt19937_64 generator(BOOTSTRAP_SEED + sample);
+    fill(sampleAgreements.begin(), sampleAgreements.end(), 0);
+    uint64_t sampleFullAgreements = 0;
+
+    // The addresses are resampled within each group, so every group keeps its
+    // size and its code. Drawing all addresses of a group with replacement
+    // is the same as drawing how often each distinct signature occurs
+    // (multinomial), which is done with one binomial draw per signature.
+    for(uint64_t groupIdx = 0; groupIdx < signatures->size(); groupIdx++) {
+      vector<uint64_t> *groupSignatures = (*signatures)[groupIdx];
+      vector<uint64_t> *groupCounts = (*signatureCounts)[groupIdx];
+      uint64_t groupCode = (*groupCodes)[groupIdx];
+      uint64_t nRemainingDraws = 0;
+      for(uint64_t count : *groupCounts) {
+        nRemainingDraws += count;
+      }
+      uint64_t nRemainingAddresses = nRemainingDraws;
+
+      for(uint64_t i = 0; i < groupSignatures->size() && nRemainingDraws > 0; i++) {
+        uint64_t nDraws = nRemainingDraws;
+        if(i + 1 < groupSignatures->size()) {
+          binomial_distribution<uint64_t> distribution(nRemainingDraws, (double)(*groupCounts)[i] / nRemainingAddresses);
+          nDraws = distribution(generator);
+        }
+        nRemainingDraws -= nDraws;
+        nRemainingAddresses -= (*groupCounts)[i];
+
+        uint64_t difference = (*groupSignatures)[i] ^ groupCode;
+        for(uint64_t maskIdx = 0; maskIdx < masks->size(); maskIdx++) {
+          if((difference>>maskIdx&1) == 0) {
+            sampleAgreements[maskIdx] += nDraws;
+          }
+        }
+        if(difference == 0) {
+          sampleFullAgreements += nDraws;
+        }
+      }
+    }
+
+    for(uint64_t maskIdx = 0; maskIdx < masks->size(); maskIdx++) {
+      (*rates)[maskIdx][sample] = (double)sampleAgreements[maskIdx] / nAddresses;
+    }
+    (*rates)[masks->size()][sample] = (double)sampleFullAgreements / nAddresses;
+  }
+}
+
+void MaskVerifier::runResampling(MaskVerifier *maskVerifier, uint64_t firstSample, uint64_t lastSample, vector<vector<double>> *rates) {
+  maskVerifier->resample(firstSample, lastSample, rates);
+}
+
+void MaskVerifier::estimateConfidenceIntervals(uint64_t nSamples, double confidence, uint64_t nThreads) {
+  confidenceIntervals->assign(masks->size(), {0, 0});
+  fullConfidenceInterval = {0, 0};
+  if(nAddresses == 0 || nSamples == 0) {
+    return;
+  }
+
+  // One row of rates per mask and one for the agreement of all masks. Each
+  // thread fills its own range of samples.
+  vector<vector<double>> rates(masks->size() + 1, vector<double>(nSamples, 0));
+  vector<thread*> threads;
+  for(uint64_t i = 0; i < nThreads; i++) {
+    uint64_t firstSample = nSamples * i / nThreads;
+    uint64_t lastSample = nSamples * (i + 1) / nThreads;
+    if(firstSample < lastSample) {
+      threads.push_back(new thread(runResampling, this, firstSample, lastSample, &rates));
+    }
+  }
+  for(thread *t : threads) {
+    t->join();
+    delete t;
+  }
+
+  // Percentile intervals: the lower and upper (1 - confidence) / 2 of the
+  // sampled rates are cut off.
+  uint64_t lowerIdx = (uint64_t)(nSamples * (1 - confidence) / 2);
+  uint64_t upperIdx = nSamples - 1 - lowerIdx;
+  for(uint64_t maskIdx = 0; maskIdx <= masks->size(); maskIdx++) {
+    sort(rates[maskIdx].begin(), rates[maskIdx].end());
+    ConfidenceInterval interval = {rates[maskIdx][lowerIdx], rates[maskIdx][upperIdx]};
+    if(maskIdx < masks->size()) {
+      (*confidenceIntervals)[maskIdx] = interval;
+    } else {
+      fullConfidenceInterval = interval;
+    }
+  }
+}
+
+ConfidenceInterval MaskVerifier::getConfidenceInterval(uint64_t maskIdx) {
+  return (*confidenceIntervals)[maskIdx];
+}
+
+ConfidenceInterval MaskVerifier::getConfidenceInterval() {
+  return fullConfidenceInterval;
+}
@@ -0,0 +1,51 @@
+#ifndef MASK_VERIFIER_H
+#define MASK_VERIFIER_H
+
+#include<cstdint>
+#include<vector>
+
+using namespace std;
+
+struct ConfidenceInterval {
+  double lower;
+  double upper;
+};
+
+/**
+ * MaskVerifier scores final address functions on a set of grouped addresses
+ * (usually addresses that were held out while the functions were derived).
+ *
+ * For every group, the results of all masks are precomputed once into a
+ * signature matrix (one word per distinct result, bit i is the result of mask
+ * i, together with the number of addresses with this result). Each
+ * group gets the code built from the majority results of all masks. The
+ * agreement rate of a mask is the share of addresses that have the same result
+ * as the majority of their group. Confidence intervals for the agreement rates
+ * are estimated by resampling the addresses of each group (bootstrap).
+ */
+class MaskVerifier {
+  private:
+    vector<uint64_t> *masks;
+    vector<vector<uint64_t>*> *signatures;
+    vector<vector<uint64_t>*> *signatureCounts;
+    vector<uint64_t> *groupCodes;
+    uint64_t nAddresses;
+    vector<uint64_t> *agreements;
+    uint64_t nFullAgreements;
+    vector<ConfidenceInterval> *confidenceIntervals;
+    ConfidenceInterval fullConfidenceInterval;
+    void resample(uint64_t firstSample, uint64_t lastSample, vector<vector<double>> *rates);
+    static void runResampling(MaskVerifier *maskVerifier, uint64_t firstSample, uint64_t lastSample, vector<vector<double>> *rates);
+  public:
+    MaskVerifier(vector<vector<uint64_t>*> *physicalAddresses, vector<uint64_t> *masks);
+    ~MaskVerifier();
+    uint64_t getNumberOfAddresses();
+    uint64_t getNumberOfDistinctGroupCodes();
+    double getAgreementRate(uint64_t maskIdx);
+    double getAgreementRate();
+    void estimateConfidenceIntervals(uint64_t nSamples, double confidence, uint64_t nThreads);
+    ConfidenceInterval getConfidenceInterval(uint64_t maskIdx);
+    ConfidenceInterval getConfidenceInterval();
+};
+
+#endif
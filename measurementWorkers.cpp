@@ -0,0 +1,207 @@
+#include<cstdio>
+#include<cstdint>
+#include<vector>
+#include<thread>
+#include<map>
+#include<cmath>
+
+#include<sched.h>
+#include<pthread.h>
+#include<unistd.h>
+
+#include "measurementWorkers.h"
+#include "helper.h"
+
+using namespace std;
+
+// Number of times every page of the THP is measured by every worker during
+// the interference check
+#define INTERFERENCE_ROUNDS 4
+// Share of the serial separation between row hits and row conflicts that has
+// to be left when all workers measure at the same time
+#define INTERFERENCE_TOLERANCE 0.8
+
+struct SeparationContext {
+  Config *config;
+  vector<void *> *thps;
+  vector<vector<uint64_t>> *times;
+};
+
+MeasurementWorkers::MeasurementWorkers(Config *config) {
+  this->config = config;
+  if(config->getMeasurementCores()->empty()) {
+    this->cores = selectCores(config->getNumberOfMeasurementWorkers());
+  } else {
+    this->cores = new vector<uint64_t>(*config->getMeasurementCores());
+  }
+  if(cores->size() < config->getNumberOfMeasurementWorkers()) {
+    printLogMessage(LOG_WARNING, "Only " + to_string(cores->size()) + " cores are available for " + to_string(config->getNumberOfMeasurementWorkers()) + " measurement workers.");
+  }
+  this->nWorkers = cores->empty() ? 1 : cores->size();
+}
+
+MeasurementWorkers::~MeasurementWorkers() {
+  delete cores;
+}
+
+static int64_t readFirstNumber(string path) {
+  FILE *file = fopen(path.c_str(), "r");
+  if(file == NULL) {
+    return -1;
+  }
+  long number = -1;
+  if(fscanf(file, "%ld", &number) != 1) {
+    number = -1;
+  }
+  fclose(file);
+  return number;
+}
+
+vector<uint64_t> *MeasurementWorkers::selectCores(uint64_t nCores) {
+  // Only the first thread of every physical core the process may run on is
+  // used. The cores are grouped by their L3 cache.
+  cpu_set_t allowedCpus;
+  CPU_ZERO(&allowedCpus);
+  sched_getaffinity(0, sizeof(allowedCpus), &allowedCpus);
+  map<int64_t, vector<uint64_t>> cacheCores;
+  for(uint64_t cpu = 0; cpu < (uint64_t)sysconf(_SC_NPROCESSORS_CONF) && cpu < CPU_SETSIZE; cpu++) {
+    if(!CPU_ISSET(cpu, &allowedCpus)) {
+      continue;
+    }
+    string cpuPath = "/sys/devices/system/cpu/cpu" + to_string(cpu);
+    int64_t firstSibling = readFirstNumber(cpuPath + "/topology/thread_siblings_list");
+    if(firstSibling != -1 && firstSibling != (int64_t)cpu) {
+      continue;
+    }
+    cacheCores[readFirstNumber(cpuPath + "/cache/index3/id")].push_back(cpu);
+  }
+
+  vector<uint64_t> *cores = new vector<uint64_t>();
+  for(uint64_t i = 0; cores->size() < nCores; i++) {
+    uint64_t nAddedCores = 0;
+    for(auto &cache : cacheCores) {
+      if(i < cache.second.size() && cores->size() < nCores) {
+        cores->push_back(cache.second[i]);
+        nAddedCores++;
+      }
+    }
+    if(nAddedCores == 0) {
+      break;
+    }
+  }
+  return cores;
+}
+
+void MeasurementWorkers::runWorker(uint64_t core, uint64_t workerIdx, uint64_t begin, uint64_t end, void (*work)(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end), void *context) {
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(core, &cpus);
+  if(pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+    printLogMessage(LOG_WARNING, "Unable to pin measurement worker " + to_string(workerIdx) + " to core " + to_string(core) + ".");
+  }
+  work(context, workerIdx, begin, end);
+}
+
+void MeasurementWorkers::run(uint64_t nWorkers, uint64_t nItems, void (*work)(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end), void *context) {
+  if(cores->empty()) {
+    work(context, 0, 0, nItems);
+    return;
+  }
+  vector<thread*> threads;
+  for(uint64_t i = 0; i < nWorkers; i++) {
+    uint64_t begin = nItems * i / nWorkers;
+    uint64_t end = nItems * (i + 1) / nWorkers;
+    if(begin < end) {
+      threads.push_back(new thread(runWorker, (*cores)[i], i, begin, end, work, context));
+    }
+  }
+  for(thread *t : threads) {
+    t->join();
+    delete t;
+  }
+}
+
+void MeasurementWorkers::run(uint64_t nItems, void (*work)(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end), void *context) {
+  run(nWorkers, nItems, work, context);
+}
+
+void MeasurementWorkers::measureSeparationTimes(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end) {
+  // Every worker measures the first page of its own THP against all others,
+  // like the threshold measurement.
+  SeparationContext *separationContext = (SeparationContext *)context;
+  Config *config = separationContext->config;
+  for(uint64_t thpIdx = begin; thpIdx < end; thpIdx++) {
+    char *thp = (char *)(*separationContext->thps)[thpIdx];
+    vector<uint64_t> *times = &(*separationContext->times)[thpIdx];
+    for(uint64_t round = 0; round < INTERFERENCE_ROUNDS; round++) {
+      for(uint64_t page = 1; page < config->getPagesPerTHP(); page++) {
+        times->push_back(measureAccessTime(thp, thp + page * sysconf(_SC_PAGESIZE), config->getNumberOfMeasurementsPerGroupAddressComparisons(), config->areMemoryFencesEnabled()));
+      }
+    }
+  }
+}
+
+double MeasurementWorkers::measureSeparation(uint64_t nWorkers) {
+  // The separation is the distance between the mean row hit and the mean row
+  // conflict time in units of their pooled standard deviation (d').
+  vector<void *> thps;
+  for(uint64_t i = 0; i < nWorkers; i++) {
+    thps.push_back(getTHP());
+  }
+  vector<vector<uint64_t>> times(nWorkers);
+  SeparationContext context = {config, &thps, &times};
+  run(nWorkers, nWorkers, measureSeparationTimes, &context);
+  for(void *thp : thps) {
+    freeTHP(thp);
+  }
+
+  double sums[2] = {0, 0};
+  double squareSums[2] = {0, 0};
+  uint64_t counts[2] = {0, 0};
+  for(vector<uint64_t> &workerTimes : times) {
+    for(uint64_t time : workerTimes) {
+      uint64_t conflict = time >= config->getRowConflictThreshold() ? 1 : 0;
+      sums[conflict] += time;
+      squareSums[conflict] += (double)time * time;
+      counts[conflict]++;
+    }
+  }
+  if(counts[0] < 2 || counts[1] < 2) {
+    return 0;
+  }
+  double means[2];
+  double variances[2];
+  for(uint64_t i = 0; i < 2; i++) {
+    means[i] = sums[i] / counts[i];
+    variances[i] = (squareSums[i] - counts[i] * means[i] * means[i]) / (counts[i] - 1);
+  }
+  double pooledDeviation = sqrt((variances[0] + variances[1]) / 2);
+  if(pooledDeviation == 0) {
+    return INFINITY;
+  }
+  return (means[1] - means[0]) / pooledDeviation;
+}
+
+void MeasurementWorkers::checkInterference() {
+  if(nWorkers < 2) {
+    return;
+  }
+  double serialSeparation = measureSeparation(1);
+  if(serialSeparation == 0) {
+    printLogMessage(LOG_WARNING, "Row hits and row conflicts could not be separated, the interference of the measurement workers is not checked.");
+    return;
+  }
+  while(nWorkers > 1) {
+    double parallelSeparation = measureSeparation(nWorkers);
+    printLogMessage(LOG_DEBUG, "Separation of row hits and row conflicts: " + to_string(serialSeparation) + " with 1 worker, " + to_string(parallelSeparation) + " with " + to_string(nWorkers) + " workers.");
+    if(parallelSeparation >= serialSeparation * INTERFERENCE_TOLERANCE) {
+      break;
+    }
+    nWorkers /= 2;
+  }
+  printLogMessage(LOG_INFO, "Using " + to_string(nWorkers) + " measurement workers.");
+}
+
+uint64_t MeasurementWorkers::getNumberOfWorkers() {
+  return nWorkers;
+}
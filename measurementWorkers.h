@@ -0,0 +1,41 @@
+#ifndef MEASUREMENT_WORKERS_H
+#define MEASUREMENT_WORKERS_H
+
+#include<cstdint>
+#include<vector>
+
+#include "config.h"
+
+using namespace std;
+
+/**
+ * MeasurementWorkers runs timing measurements on several cores at once. Every
+ * worker is a thread pinned to its own core and gets a disjoint, contiguous
+ * range of the items to measure.
+ *
+ * Without configured cores, one thread of every physical core is used (no SMT
+ * siblings), taken round-robin from the L3 caches (CCDs on AMD), so workers
+ * share as few resources as possible. Before the workers are used, the
+ * separation between row hits and row conflicts is measured with all workers
+ * and with a single worker. The number of workers is halved while the
+ * parallel separation is clearly worse than the serial one.
+ */
+class MeasurementWorkers {
+  private:
+    Config *config;
+    vector<uint64_t> *cores;
+    uint64_t nWorkers;
+    void run(uint64_t nWorkers, uint64_t nItems, void (*work)(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end), void *context);
+    static void runWorker(uint64_t core, uint64_t workerIdx, uint64_t begin, uint64_t end, void (*work)(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end), void *context);
+    double measureSeparation(uint64_t nWorkers);
+    static void measureSeparationTimes(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end);
+  public:
+    MeasurementWorkers(Config *config);
+    ~MeasurementWorkers();
+    static vector<uint64_t> *selectCores(uint64_t nCores);
+    void checkInterference();
+    uint64_t getNumberOfWorkers();
+    void run(uint64_t nItems, void (*work)(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end), void *context);
+};
+
+#endif
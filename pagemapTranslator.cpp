@@ -0,0 +1,121 @@
+#include<cstdio>
+#include<cstdint>
+#include<vector>
+#include<mutex>
+#include<unordered_map>
+
+#include<errno.h>
+#include<fcntl.h>
+#include<string.h>
+#include<unistd.h>
+
+#include "pagemapTranslator.h"
+
+using namespace std;
+
+// Bits 0-54 of a pagemap entry are the PFN
+#define PAGEMAP_PFN_MASK ((1UL<<55) - 1)
+
+PagemapTranslator::PagemapTranslator(uint64_t regionSize) {
+  this->pageSize = sysconf(_SC_PAGESIZE);
+  this->regionSize = regionSize < pageSize ? pageSize : regionSize;
+  this->regions = new unordered_map<uint64_t, vector<uint64_t>>();
+  this->fd = open("/proc/self/pagemap", O_RDONLY);
+  if(fd == -1) {
+    printf("Unable to open '/proc/self/pagemap'. Error: %s\n", strerror(errno));
+  }
+}
+
+PagemapTranslator::~PagemapTranslator() {
+  if(fd != -1) {
+    close(fd);
+  }
+  delete regions;
+}
+
+void PagemapTranslator::readRegion(uint64_t regionIdx, vector<uint64_t> *pfns) {
+  // Has to be called with regionsMutex locked
+  uint64_t nPages = regionSize / pageSize;
+  pfns->assign(nPages, 0);
+  uint64_t offset = regionIdx * nPages * sizeof(uint64_t);
+  ssize_t nBytesRead = -1;
+  if(fd != -1) {
+    nBytesRead = pread(fd, pfns->data(), nPages * sizeof(uint64_t), offset);
+    if(nBytesRead == -1) {
+      printf("Unable to read %ld bytes at offset %ld in file '/proc/self/pagemap'. Error: %s\n", nPages * sizeof(uint64_t), offset, strerror(errno));
+    }
+  }
+
+  // Pages that are not present (or PFNs that can not be read) are read again
+  // next time
+  bool cacheable = nBytesRead == (ssize_t)(nPages * sizeof(uint64_t));
+  bool contiguous = true;
+  for(uint64_t i = 0; i < nPages; i++) {
+    (*pfns)[i] &= PAGEMAP_PFN_MASK;
+    if((*pfns)[i] == 0) {
+      cacheable = false;
+    }
+    if((*pfns)[i] != (*pfns)[0] + i) {
+      contiguous = false;
+    }
+  }
+  if(contiguous) {
+    pfns->resize(1);
+  }
+  if(cacheable) {
+    (*regions)[regionIdx] = *pfns;
+  }
+}
+
+vector<uint64_t> *PagemapTranslator::getRegion(uint64_t regionIdx, vector<uint64_t> *uncachedPfns) {
+  // Has to be called with regionsMutex locked
+  auto region = regions->find(regionIdx);
+  if(region != regions->end()) {
+    return &region->second;
+  }
+  readRegion(regionIdx, uncachedPfns);
+  return uncachedPfns;
+}
+
+uint64_t PagemapTranslator::translateInRegion(vector<uint64_t> *pfns, uint64_t address) {
+  uint64_t pageIdx = (address % regionSize) / pageSize;
+  uint64_t pfn = pfns->size() == 1 ? (*pfns)[0] + pageIdx : (*pfns)[pageIdx];
+  return pfn * pageSize | (address & (pageSize - 1));
+}
+
+uint64_t PagemapTranslator::translate(void *address) {
+  vector<uint64_t> uncachedPfns;
+  regionsMutex.lock();
+  vector<uint64_t> *pfns = getRegion((uint64_t)address / regionSize, &uncachedPfns);
+  uint64_t physicalAddress = translateInRegion(pfns, (uint64_t)address);
+  regionsMutex.unlock();
+  return physicalAddress;
+}
+
+vector<uint64_t> *PagemapTranslator::translate(vector<void *> *addresses) {
+  // Consecutive addresses are usually in the same region, so the region is
+  // only looked up when it changes.
+  vector<uint64_t> *physicalAddresses = new vector<uint64_t>();
+  physicalAddresses->reserve(addresses->size());
+  vector<uint64_t> uncachedPfns;
+  vector<uint64_t> *pfns = NULL;
+  uint64_t regionIdx = 0;
+  regionsMutex.lock();
+  for(void *address : *addresses) {
+    if(pfns == NULL || (uint64_t)address / regionSize != regionIdx) {
+      regionIdx = (uint64_t)address / regionSize;
+      pfns = getRegion(regionIdx, &uncachedPfns);
+    }
+    physicalAddresses->push_back(translateInRegion(pfns, (uint64_t)address));
+  }
+  regionsMutex.unlock();
+  return physicalAddresses;
+}
+
+void PagemapTranslator::invalidate(void *address, uint64_t size) {
+  regionsMutex.lock();
+  for(uint64_t regionIdx = (uint64_t)address / regionSize; regionIdx * regionSize < (uint64_t)address + size; regionIdx++) {
+    regions->erase(regionIdx);
+  }
+  regionsMutex.unlock();
+}
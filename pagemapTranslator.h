@@ -0,0 +1,39 @@
+#ifndef PAGEMAP_TRANSLATOR_H
+#define PAGEMAP_TRANSLATOR_H
+
+#include<cstdint>
+#include<vector>
+#include<mutex>
+#include<unordered_map>
+
+using namespace std;
+
+/**
+ * PagemapTranslator resolves virtual to physical addresses with
+ * /proc/self/pagemap. The file stays open and the entries of a whole region
+ * (usually a huge page) are read with one pread. The PFNs of a region are
+ * cached; a physically contiguous region only keeps its first PFN. Regions
+ * with pages that are not present are not cached.
+ *
+ * The cache has to be invalidated when memory is unmapped, since the virtual
+ * addresses can be mapped to other physical pages afterwards.
+ */
+class PagemapTranslator {
+  private:
+    int fd;
+    uint64_t pageSize;
+    uint64_t regionSize;
+    unordered_map<uint64_t, vector<uint64_t>> *regions;
+    mutex regionsMutex;
+    void readRegion(uint64_t regionIdx, vector<uint64_t> *pfns);
+    vector<uint64_t> *getRegion(uint64_t regionIdx, vector<uint64_t> *uncachedPfns);
+    uint64_t translateInRegion(vector<uint64_t> *pfns, uint64_t address);
+  public:
+    PagemapTranslator(uint64_t regionSize);
+    ~PagemapTranslator();
+    uint64_t translate(void *address);
+    vector<uint64_t> *translate(vector<void *> *addresses);
+    void invalidate(void *address, uint64_t size);
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include<cstdint>
+#include<vector>
+#include<algorithm>
+#include<cmath>
+
+#include "pivotClustering.h"
+#include "helper.h"
+
+using namespace std;
+
+// Cosine similarity of the addresses two pivots conflict with above which the
+// pivots are in the same bank. Pivots of different banks only share the
+// addresses of wrong measurements.
+#define PIVOT_SIMILARITY 0.3
+// Number of addresses a pivot has to conflict with to be used at all
+#define PIVOT_MIN_CONFLICTS 2
+
+PivotClustering::PivotClustering(Config *config, MeasurementWorkers *measurementWorkers, uint64_t threshold) {
+  this->config = config;
+  this->measurementWorkers = measurementWorkers;
+  this->threshold = threshold;
+  this->addresses = NULL;
+  this->pivots = new vector<void *>();
+  this->nPivotWords = 0;
+  this->features = new vector<uint64_t>();
+}
+
+PivotClustering::~PivotClustering() {
+  delete pivots;
+  delete features;
+}
+
+uint64_t PivotClustering::getNumberOfPivots() {
+  return pivots->size();
+}
+
+void PivotClustering::measureFeatures(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end) {
+  // Bit p of the features of an address is set when it conflicts with pivot p
+  PivotClustering *clustering = (PivotClustering *)context;
+  uint64_t nMeasurements = clustering->config->getNumberOfMeasurementsPerGroupAddressComparisons();
+  bool fenced = clustering->config->areMemoryFencesEnabled();
+  for(uint64_t addressIdx = begin; addressIdx < end; addressIdx++) {
+    uint64_t *addressFeatures = &(*clustering->features)[addressIdx * clustering->nPivotWords];
+    for(uint64_t pivotIdx = 0; pivotIdx < clustering->pivots->size(); pivotIdx++) {
+      if(measureAccessTime((*clustering->addresses)[addressIdx], (*clustering->pivots)[pivotIdx], nMeasurements, fenced) >= clustering->threshold) {
+        addressFeatures[pivotIdx / 64] |= (1UL<<(pivotIdx % 64));
+      }
+    }
+  }
+}
+
+vector<vector<uint64_t>> *PivotClustering::clusterPivots() {
+  // The features are transposed, so the addresses a pivot conflicts with are
+  // a bit set that can be compared with the one of another pivot.
+  uint64_t nAddressWords = (addresses->size() + 63) / 64;
+  vector<vector<uint64_t>> columns(pivots->size(), vector<uint64_t>(nAddressWords, 0));
+  vector<uint64_t> nConflicts(pivots->size(), 0);
+  for(uint64_t addressIdx = 0; addressIdx < addresses->size(); addressIdx++) {
+    for(uint64_t pivotIdx = 0; pivotIdx < pivots->size(); pivotIdx++) {
+      if((*features)[addressIdx * nPivotWords + pivotIdx / 64] & (1UL<<(pivotIdx % 64))) {
+        columns[pivotIdx][addressIdx / 64] |= (1UL<<(addressIdx % 64));
+        nConflicts[pivotIdx]++;
+      }
+    }
+  }
+
+  // Connected components of the pivots that are similar enough
+  vector<uint64_t> components(pivots->size());
+  for(uint64_t i = 0; i < pivots->size(); i++) {
+    components[i] = i;
+  }
+  for(uint64_t i = 0; i < pivots->size(); i++) {
+    if(nConflicts[i] < PIVOT_MIN_CONFLICTS) {
+      continue;
+    }
+    for(uint64_t j = i + 1; j < pivots->size(); j++) {
+      if(nConflicts[j] < PIVOT_MIN_CONFLICTS) {
+        continue;
+      }
+      uint64_t nIntersection = 0;
+      for(uint64_t word = 0; word < nAddressWords; word++) {
+        nIntersection += __builtin_popcountl(columns[i][word] & columns[j][word]);
+      }
+      if(nIntersection >= PIVOT_SIMILARITY * sqrt((double)nConflicts[i] * nConflicts[j]) && components[i] != components[j]) {
+        uint64_t oldComponent = components[j];
+        for(uint64_t &component : components) {
+          if(component == oldComponent) {
+            component = components[i];
+          }
+        }
+      }
+    }
+  }
+
+  vector<vector<uint64_t>> *pivotClusters = new vector<vector<uint64_t>>();
+  vector<int64_t> clusterIndices(pivots->size(), -1);
+  for(uint64_t i = 0; i < pivots->size(); i++) {
+    if(nConflicts[i] < PIVOT_MIN_CONFLICTS) {
+      continue;
+    }
+    if(clusterIndices[components[i]] == -1) {
+      clusterIndices[components[i]] = pivotClusters->size();
+      pivotClusters->push_back(vector<uint64_t>());
+    }
+    (*pivotClusters)[clusterIndices[components[i]]].push_back(i);
+  }
+  return pivotClusters;
+}
+
+vector<vector<void *>*> *PivotClustering::cluster(vector<void *> *addresses, vector<void *> *pivots, vector<void *> *unassignedAddresses) {
+  this->addresses = addresses;
+  this->pivots->clear();
+  if(pivots != NULL && !pivots->empty()) {
+    *this->pivots = *pivots;
+  } else {
+    uint64_t nPivots = min(config->getNumberOfPivots(), (uint64_t)addresses->size());
+    vector<uint64_t> pivotIndices(nPivots);
+    getRandomIndices(addresses->size(), nPivots, pivotIndices.data());
+    for(uint64_t pivotIdx : pivotIndices) {
+      this->pivots->push_back((*addresses)[pivotIdx]);
+    }
+  }
+  pivots = this->pivots;
+  nPivotWords = (pivots->size() + 63) / 64;
+  features->assign(addresses->size() * nPivotWords, 0);
+  if(measurementWorkers != NULL) {
+    measurementWorkers->run(addresses->size(), measureFeatures, this);
+  } else {
+    measureFeatures(this, 0, 0, addresses->size());
+  }
+
+  vector<vector<uint64_t>> *pivotClusters = clusterPivots();
+  vector<vector<void *>*> *clusters = new vector<vector<void *>*>();
+  for(uint64_t i = 0; i < pivotClusters->size(); i++) {
+    clusters->push_back(new vector<void *>());
+  }
+
+  // The mode of a cluster conflicts with its pivots and no others. An address
+  // belongs to the cluster with the closest mode (Hamming distance), which is
+  // the one with the most conflicts minus misses among its pivots. It stays
+  // unassigned when that is not clear (tie or more misses than conflicts).
+  for(uint64_t addressIdx = 0; addressIdx < addresses->size(); addressIdx++) {
+    uint64_t *addressFeatures = &(*features)[addressIdx * nPivotWords];
+    int64_t bestScore = 0;
+    int64_t secondBestScore = 0;
+    int64_t bestCluster = -1;
+    for(uint64_t clusterIdx = 0; clusterIdx < pivotClusters->size(); clusterIdx++) {
+      vector<uint64_t> *pivotCluster = &(*pivotClusters)[clusterIdx];
+      int64_t nConflicts = 0;
+      for(uint64_t pivotIdx : *pivotCluster) {
+        if(addressFeatures[pivotIdx / 64] & (1UL<<(pivotIdx % 64))) {
+          nConflicts++;
+        }
+      }
+      int64_t score = 2 * nConflicts - (int64_t)pivotCluster->size();
+      if(score > bestScore) {
+        secondBestScore = bestScore;
+        bestScore = score;
+        bestCluster = clusterIdx;
+      } else if(score > secondBestScore) {
+        secondBestScore = score;
+      }
+    }
+    if(bestCluster != -1 && bestScore > secondBestScore) {
+      (*clusters)[bestCluster]->push_back((*addresses)[addressIdx]);
+    } else {
+      unassignedAddresses->push_back((*addresses)[addressIdx]);
+    }
+  }
+  delete pivotClusters;
+
+  // Clusters without addresses (all of their addresses were ambiguous)
+  vector<vector<void *>*> *nonEmptyClusters = new vector<vector<void *>*>();
+  for(vector<void *> *cluster : *clusters) {
+    if(cluster->empty()) {
+      delete cluster;
+    } else {
+      nonEmptyClusters->push_back(cluster);
+    }
+  }
+  delete clusters;
+  this->addresses = NULL;
+  return nonEmptyClusters;
+}
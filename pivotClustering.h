@@ -0,0 +1,44 @@
+#ifndef PIVOT_CLUSTERING_H
+#define PIVOT_CLUSTERING_H
+
+#include<cstdint>
+#include<vector>
+
+#include "config.h"
+#include "measurementWorkers.h"
+
+using namespace std;
+
+/**
+ * PivotClustering groups addresses without comparing them to groups. Every
+ * address is measured once against each of a few pivot addresses (random ones
+ * unless they are given), which gives a conflict feature for every pivot.
+ * Grouping then only works on these features, so the order of the addresses
+ * does not matter and every address costs one measurement per pivot.
+ *
+ * Two pivots of the same bank conflict with the same addresses, so pivots are
+ * merged (connected components) when the addresses they conflict with mostly
+ * agree (cosine similarity). Over all addresses, this is hardly affected by
+ * single wrong measurements. Every address is then assigned to the closest
+ * pivot cluster, like k-modes with the clusters as modes. Addresses without a
+ * clear cluster (e.g. of a bank without pivot) are returned as unassigned.
+ */
+class PivotClustering {
+  private:
+    Config *config;
+    MeasurementWorkers *measurementWorkers;
+    uint64_t threshold;
+    vector<void *> *addresses;
+    vector<void *> *pivots;
+    uint64_t nPivotWords;
+    vector<uint64_t> *features;
+    vector<vector<uint64_t>> *clusterPivots();
+    static void measureFeatures(void *context, uint64_t workerIdx, uint64_t begin, uint64_t end);
+  public:
+    PivotClustering(Config *config, MeasurementWorkers *measurementWorkers, uint64_t threshold);
+    ~PivotClustering();
+    vector<vector<void *>*> *cluster(vector<void *> *addresses, vector<void *> *pivots, vector<void *> *unassignedAddresses);
+    uint64_t getNumberOfPivots();
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include<cstdint>
+#include<map>
+#include<cmath>
+#include<algorithm>
+
+#include<unistd.h>
+
+#include "thresholdEstimator.h"
+#include "helper.h"
+
+using namespace std;
+
+// The threshold is stable when it changed by at most this percentage
+#define THRESHOLD_TOLERANCE_PERCENTAGE 2
+// Number of consecutive stable rounds before the estimation stops
+#define THRESHOLD_STABLE_ROUNDS 2
+// Times above this multiple of the median are outliers
+#define OUTLIER_FACTOR 3
+// Minimum share of the times in each class of a split
+#define MIN_CLASS_SHARE 0.01
+// Lower limit for the variance of a class, times are integers
+#define MIN_VARIANCE 1.0
+
+ThresholdEstimator::ThresholdEstimator(Config *config) {
+  this->config = config;
+  this->histogram = new map<uint64_t, uint64_t>();
+  this->nRounds = 0;
+  this->separation = 0;
+}
+
+ThresholdEstimator::~ThresholdEstimator() {
+  delete histogram;
+}
+
+void ThresholdEstimator::measureRound(void *thp) {
+  for(uint64_t page = 1; page < config->getPagesPerTHP(); page++) {
+    uint64_t time = measureAccessTime(thp, (char *)thp + page * sysconf(_SC_PAGESIZE), config->getNumberOfMeasurementsPerGroupAddressComparisons(), config->areMemoryFencesEnabled());
+    (*histogram)[time]++;
+  }
+  nRounds++;
+}
+
+uint64_t ThresholdEstimator::estimate() {
+  // The THP is only mapped once for all rounds
+  void *thp = getTHP();
+  uint64_t threshold = 0;
+  uint64_t nStableRounds = 0;
+  while(nRounds < config->getNumberOfMeasurementsForThreshold() && nStableRounds < THRESHOLD_STABLE_ROUNDS) {
+    measureRound(thp);
+    uint64_t newThreshold = getMinimumErrorThreshold(histogram, &separation);
+    uint64_t difference = newThreshold > threshold ? newThreshold - threshold : threshold - newThreshold;
+    if(nRounds > 1 && difference * 100 <= threshold * THRESHOLD_TOLERANCE_PERCENTAGE) {
+      nStableRounds++;
+    } else {
+      nStableRounds = 0;
+    }
+    threshold = newThreshold;
+  }
+  freeTHP(thp);
+  return threshold;
+}
+
+uint64_t ThresholdEstimator::getNumberOfRounds() {
+  return nRounds;
+}
+
+double ThresholdEstimator::getSeparation() {
+  return separation;
+}
+
+uint64_t ThresholdEstimator::getMinimumErrorThreshold(map<uint64_t, uint64_t> *histogram, double *separation) {
+  // Single times that were interrupted would get a class of their own, so
+  // times far above the median are left out.
+  uint64_t nTimes = 0;
+  for(auto &bucket : *histogram) {
+    nTimes += bucket.second;
+  }
+  uint64_t median = 0;
+  uint64_t nSeenTimes = 0;
+  for(auto &bucket : *histogram) {
+    nSeenTimes += bucket.second;
+    if(nSeenTimes * 2 >= nTimes) {
+      median = bucket.first;
+      break;
+    }
+  }
+  auto end = histogram->upper_bound(median * OUTLIER_FACTOR);
+
+  // Minimum error thresholding (Kittler and Illingworth): both classes are
+  // modeled as normal distributions with their own share and variance, the
+  // split with the smallest classification error criterion
+  //   J = P1 ln(var1) + P2 ln(var2) - 2 (P1 ln(P1) + P2 ln(P2))
+  // is used. Unlike Otsu's method, this does not move the split into the
+  // bigger class when the classes are of very different size (only about
+  // 1/nBanks of the times are row conflicts).
+  double totalCount = 0;
+  double totalSum = 0;
+  double totalSquareSum = 0;
+  for(auto bucket = histogram->begin(); bucket != end; bucket++) {
+    totalCount += bucket->second;
+    totalSum += (double)bucket->first * bucket->second;
+    totalSquareSum += (double)bucket->first * bucket->first * bucket->second;
+  }
+
+  // The sums of the lower class are accumulated while the split moves up, the
+  // upper class is the rest. The threshold is in the middle between the last
+  // time of the lower and the first time of the upper class.
+  double lowerCount = 0;
+  double lowerSum = 0;
+  double lowerSquareSum = 0;
+  double minCount = max(totalCount * MIN_CLASS_SHARE, 2.0);
+  double bestCriterion = INFINITY;
+  double bestSeparation = 0;
+  uint64_t threshold = 0;
+  for(auto bucket = histogram->begin(); bucket != end; bucket++) {
+    auto nextBucket = next(bucket);
+    if(nextBucket == end) {
+      break;
+    }
+    lowerCount += bucket->second;
+    lowerSum += (double)bucket->first * bucket->second;
+    lowerSquareSum += (double)bucket->first * bucket->first * bucket->second;
+    double upperCount = totalCount - lowerCount;
+    if(lowerCount < minCount || upperCount < minCount) {
+      continue;
+    }
+    double lowerMean = lowerSum / lowerCount;
+    double upperMean = (totalSum - lowerSum) / upperCount;
+    double lowerVariance = max(lowerSquareSum / lowerCount - lowerMean * lowerMean, MIN_VARIANCE);
+    double upperVariance = max((totalSquareSum - lowerSquareSum) / upperCount - upperMean * upperMean, MIN_VARIANCE);
+    double lowerShare = lowerCount / totalCount;
+    double upperShare = upperCount / totalCount;
+    double criterion = lowerShare * log(lowerVariance) + upperShare * log(upperVariance) - 2 * (lowerShare * log(lowerShare) + upperShare * log(upperShare));
+    if(criterion < bestCriterion) {
+      bestCriterion = criterion;
+      // Distance of both means in units of their pooled standard deviation (d')
+      bestSeparation = (upperMean - lowerMean) / sqrt((lowerVariance + upperVariance) / 2);
+      threshold = (bucket->first + nextBucket->first + 1) / 2;
+    }
+  }
+
+  if(separation != NULL) {
+    *separation = bestSeparation;
+  }
+  return threshold;
+}
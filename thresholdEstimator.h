@@ -0,0 +1,40 @@
+#ifndef THRESHOLD_ESTIMATOR_H
+#define THRESHOLD_ESTIMATOR_H
+
+#include<cstdint>
+#include<map>
+
+#include "config.h"
+
+using namespace std;
+
+/**
+ * ThresholdEstimator measures the threshold between row hits and row
+ * conflicts. The first page of one THP is measured against all other pages in
+ * rounds, all times go into one histogram. After every round, the histogram is
+ * split into row hits and row conflicts with minimum error thresholding
+ * (Kittler and Illingworth), which fits a normal distribution with its own
+ * share and variance to each class. Only about 1/nBanks of the times are row
+ * conflicts, so a split that assumes classes of similar size (Otsu's method)
+ * would cut into the tail of the row hits. The estimation stops when the
+ * threshold stayed within a tolerance for some rounds. The separation of both
+ * classes (d', distance of the means in pooled standard deviations) tells
+ * whether the histogram had two classes at all.
+ */
+class ThresholdEstimator {
+  private:
+    Config *config;
+    map<uint64_t, uint64_t> *histogram;
+    uint64_t nRounds;
+    double separation;
+    void measureRound(void *thp);
+  public:
+    ThresholdEstimator(Config *config);
+    ~ThresholdEstimator();
+    uint64_t estimate();
+    uint64_t getNumberOfRounds();
+    double getSeparation();
+    static uint64_t getMinimumErrorThreshold(map<uint64_t, uint64_t> *histogram, double *separation = NULL);
+};
+
+#endif
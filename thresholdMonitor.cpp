@@ -0,0 +1,119 @@
+#include<cstdint>
+#include<vector>
+#include<map>
+#include<mutex>
+#include<atomic>
+#include<thread>
+#include<chrono>
+#include<condition_variable>
+
+#include "thresholdMonitor.h"
+#include "thresholdEstimator.h"
+#include "logger.h"
+
+using namespace std;
+
+// Number of most recent access times the threshold is derived from
+#define THRESHOLD_MONITOR_WINDOW 8192
+// Time between two checks of the threshold
+#define THRESHOLD_MONITOR_INTERVAL_MS 1000
+// The threshold is only moved when the split moved by more than this
+// percentage
+#define THRESHOLD_DRIFT_PERCENTAGE 5
+// Minimum number of times in the window on each side of the split
+#define THRESHOLD_MONITOR_MIN_CLASS_SIZE 64
+// Minimum distance of the means of both classes in pooled standard deviations
+// (d'), so a single mode is not split. Splitting only row hits gives about 4.
+#define THRESHOLD_MONITOR_MIN_SEPARATION 4.5
+
+ThresholdMonitor::ThresholdMonitor(uint64_t threshold) {
+  this->threshold = threshold;
+  this->window = new vector<uint64_t>(THRESHOLD_MONITOR_WINDOW, 0);
+  this->nextWindowIdx = 0;
+  this->nTimes = 0;
+  this->pendingThreshold = 0;
+  this->stopped = false;
+  this->monitorThread = new thread(&ThresholdMonitor::run, this);
+}
+
+ThresholdMonitor::~ThresholdMonitor() {
+  stopMutex.lock();
+  stopped = true;
+  stopMutex.unlock();
+  stopCondition.notify_all();
+  monitorThread->join();
+  delete monitorThread;
+  delete window;
+}
+
+void ThresholdMonitor::addTime(uint64_t time) {
+  windowMutex.lock();
+  (*window)[nextWindowIdx] = time;
+  nextWindowIdx = (nextWindowIdx + 1) % window->size();
+  nTimes++;
+  windowMutex.unlock();
+}
+
+uint64_t ThresholdMonitor::getThreshold() {
+  return threshold;
+}
+
+bool ThresholdMonitor::isDrift(uint64_t oldThreshold, uint64_t newThreshold) {
+  uint64_t difference = newThreshold > oldThreshold ? newThreshold - oldThreshold : oldThreshold - newThreshold;
+  return difference * 100 > oldThreshold * THRESHOLD_DRIFT_PERCENTAGE;
+}
+
+void ThresholdMonitor::checkThreshold() {
+  // Only a full window of times that were not checked before is used
+  map<uint64_t, uint64_t> histogram;
+  windowMutex.lock();
+  if(nTimes < window->size()) {
+    windowMutex.unlock();
+    return;
+  }
+  for(uint64_t time : *window) {
+    histogram[time]++;
+  }
+  nTimes = 0;
+  windowMutex.unlock();
+
+  double separation = 0;
+  uint64_t newThreshold = ThresholdEstimator::getMinimumErrorThreshold(&histogram, &separation);
+  if(separation < THRESHOLD_MONITOR_MIN_SEPARATION) {
+    pendingThreshold = 0;
+    return;
+  }
+  uint64_t nConflicts = 0;
+  for(auto bucket = histogram.lower_bound(newThreshold); bucket != histogram.end(); bucket++) {
+    nConflicts += bucket->second;
+  }
+  if(nConflicts < THRESHOLD_MONITOR_MIN_CLASS_SIZE || window->size() - nConflicts < THRESHOLD_MONITOR_MIN_CLASS_SIZE) {
+    pendingThreshold = 0;
+    return;
+  }
+
+  // A moved split has to be confirmed by the next window before the threshold
+  // is changed
+  uint64_t oldThreshold = threshold;
+  if(!isDrift(oldThreshold, newThreshold)) {
+    pendingThreshold = 0;
+    return;
+  }
+  if(pendingThreshold == 0 || isDrift(pendingThreshold, newThreshold)) {
+    pendingThreshold = newThreshold;
+    return;
+  }
+  threshold = newThreshold;
+  pendingThreshold = 0;
+  printLogMessage(LOG_INFO, "Row conflict threshold drifted from " + to_string(oldThreshold) + " to " + to_string(newThreshold) + ".");
+}
+
+void ThresholdMonitor::run() {
+  unique_lock<mutex> lock(stopMutex);
+  while(!stopped) {
+    stopCondition.wait_for(lock, chrono::milliseconds(THRESHOLD_MONITOR_INTERVAL_MS));
+    if(!stopped) {
+      checkThreshold();
+    }
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef THRESHOLD_MONITOR_H
+#define THRESHOLD_MONITOR_H
+
+#include<cstdint>
+#include<vector>
+#include<mutex>
+#include<atomic>
+#include<thread>
+#include<condition_variable>
+
+using namespace std;
+
+/**
+ * ThresholdMonitor follows drifts of the row conflict threshold during long
+ * runs (e.g. thermal or frequency changes). The access times that are
+ * measured anyway are added to a rolling window. A background thread splits
+ * the window into row hits and row conflicts with minimum error thresholding
+ * from time to time. The threshold is moved when the split clearly separates
+ * both classes relative to their spread, both are big enough and two windows
+ * in a row agree on the moved split.
+ */
+class ThresholdMonitor {
+  private:
+    atomic<uint64_t> threshold;
+    vector<uint64_t> *window;
+    uint64_t nextWindowIdx;
+    uint64_t nTimes;
+    uint64_t pendingThreshold;
+    mutex windowMutex;
+    atomic<bool> stopped;
+    mutex stopMutex;
+    condition_variable stopCondition;
+    thread *monitorThread;
+    bool isDrift(uint64_t oldThreshold, uint64_t newThreshold);
+    void checkThreshold();
+    void run();
+  public:
+    ThresholdMonitor(uint64_t threshold);
+    ~ThresholdMonitor();
+    void addTime(uint64_t time);
+    uint64_t getThreshold();
+};
+
+#endif
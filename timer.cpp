@@ -0,0 +1,70 @@
+#include<cstdint>
+#include<cstring>
+#include<ctime>
+
+#include<unistd.h>
+#include<sys/syscall.h>
+#include<linux/perf_event.h>
+
+#include "timer.h"
+#include "config.h"
+#include "asm.h"
+
+// Every thread counts its own cycles, so the counter is opened per thread
+static thread_local int perfCyclesFd = -1;
+
+uint64_t readTimerRdtscp() {
+  return rdtscp();
+}
+
+uint64_t readTimerLfenceRdtsc() {
+  return lfenceRdtsc();
+}
+
+uint64_t readTimerMonotonicRaw() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+  return time.tv_sec * 1000000000UL + time.tv_nsec;
+}
+
+static int openPerfCycles() {
+  struct perf_event_attr attributes;
+  memset(&attributes, 0, sizeof(attributes));
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.size = sizeof(attributes);
+  attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  return syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+uint64_t readTimerPerfCycles() {
+  if(perfCyclesFd == -1) {
+    perfCyclesFd = openPerfCycles();
+  }
+  uint64_t cycles = 0;
+  if(read(perfCyclesFd, &cycles, sizeof(cycles)) != sizeof(cycles)) {
+    return 0;
+  }
+  return cycles;
+}
+
+bool isPerfCyclesTimerAvailable() {
+  if(perfCyclesFd == -1) {
+    perfCyclesFd = openPerfCycles();
+  }
+  return perfCyclesFd != -1;
+}
+
+uint64_t (*getTimer(uint64_t timerType))() {
+  switch(timerType) {
+    case TIMER_LFENCE_RDTSC:
+      return readTimerLfenceRdtsc;
+    case TIMER_MONOTONIC_RAW:
+      return readTimerMonotonicRaw;
+    case TIMER_PERF_CYCLES:
+      return readTimerPerfCycles;
+    default:
+      return readTimerRdtscp;
+  }
+}
@@ -0,0 +1,19 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include<cstdint>
+
+/**
+ * Timing sources for the access time measurements. All of them return a
+ * monotonically increasing value: rdtscp and lfence+rdtsc return time stamp
+ * counter cycles, clock_gettime(CLOCK_MONOTONIC_RAW) returns nanoseconds and
+ * perf_event returns the core cycles of the calling thread.
+ */
+uint64_t readTimerRdtscp();
+uint64_t readTimerLfenceRdtsc();
+uint64_t readTimerMonotonicRaw();
+uint64_t readTimerPerfCycles();
+bool isPerfCyclesTimerAvailable();
+uint64_t (*getTimer(uint64_t timerType))();
+
+#endif